@@ -0,0 +1,202 @@
+// Copyright(c) 2024, Pete Brubaker <pete.brubaker@intel.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// ISPC: Making CPU SIMD fun while tracing rays!
+//
+// Graphics Programming Conference 2024
+// https://www.graphicsprogrammingconference.nl/
+//
+// Kernel Buffer Allocation
+//
+// Allocate hands out buffers for the kernels that are at least cache line
+// aligned, optionally backed by 2MB transparent huge pages to cut TLB misses on
+// large arrays, and optionally first touched by the task system so their pages
+// are spread over the NUMA nodes of its threads instead of all landing on the
+// node of the allocating thread. Allocator wraps it for the standard
+// containers, Memory::Vector<float> can go anywhere a std::vector<float> does.
+// Huge pages are Linux only (madvise), elsewhere those buffers are just aligned.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <new>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#endif
+
+#include "tasksys.h"
+
+namespace Memory
+{
+	static constexpr size_t CACHE_LINE_SIZE = 64;
+	static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+	// how a buffer is placed, the flags combine
+	enum Placement : uint32_t
+	{
+		PLACEMENT_ALIGNED = 0,          // cache line aligned
+		PLACEMENT_HUGE_PAGES = 1 << 0,  // huge page aligned, with transparent huge pages requested
+		PLACEMENT_FIRST_TOUCH = 1 << 1, // zeroed by the task system, see FirstTouch
+	};
+
+	// whether PLACEMENT_HUGE_PAGES gets huge pages, transparent huge pages can be disabled system wide
+	inline bool HugePagesAvailable()
+	{
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+		std::ifstream file("/sys/kernel/mm/transparent_hugepage/enabled");
+		std::string mode;
+		std::getline(file, mode);
+
+		return mode.find("[always]") != std::string::npos || mode.find("[madvise]") != std::string::npos;
+#else
+		return false;
+#endif
+	}
+
+	// elements per task in the kernels' launches, TASK_CHUNK_SIZE in common/tasks.isph
+	static constexpr size_t TASK_CHUNK_SIZE = 16 * 1024;
+
+	// Zero the buffer with one task per chunk of TASK_CHUNK_SIZE elements, launched on the task system
+	// like the _Tasks kernels. With the default first touch policy a page lives on the NUMA node of the
+	// thread that first wrote it, so the buffer is split over the nodes of the pool's threads. That is all
+	// this guarantees: the threads aren't pinned, tasks are work stolen so a later launch can run a chunk
+	// on another thread than the one that touched it, and a huge page holds many chunks but goes to one node.
+	inline void FirstTouch(void* ptr, const size_t bytes, const size_t elementSize)
+	{
+		// an element size of 0 would make empty chunks, treat it as bytes
+		const size_t chunkBytes = TASK_CHUNK_SIZE * std::max<size_t>(1, elementSize);
+		const size_t chunks = (bytes + chunkBytes - 1) / chunkBytes;
+
+		auto touch = [=](const int chunk, int)
+		{
+			const size_t first = chunk * chunkBytes;
+			const size_t last = std::min(bytes, first + chunkBytes);
+
+			std::memset(static_cast<char*>(ptr) + first, 0, last - first);
+		};
+
+		TaskSys::Launch(static_cast<int>(chunks), touch);
+	}
+
+	// returns null if the allocation fails, release with Free
+	// elementSize sets the chunks PLACEMENT_FIRST_TOUCH zeroes, see FirstTouch
+	inline void* Allocate(const size_t bytes, const uint32_t placement = PLACEMENT_ALIGNED, const size_t elementSize = 1)
+	{
+		const bool hugePages = (placement & PLACEMENT_HUGE_PAGES) != 0;
+		const size_t alignment = hugePages ? HUGE_PAGE_SIZE : CACHE_LINE_SIZE;
+		const size_t size = std::max<size_t>(1, (bytes + alignment - 1) / alignment * alignment);
+
+#if defined(_WIN32)
+		void* ptr = _aligned_malloc(size, alignment);
+#else
+		void* ptr = std::aligned_alloc(alignment, size);
+#endif
+
+		if (!ptr)
+		{
+			return nullptr;
+		}
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+		// before anything touches the pages, so the faults can map whole huge pages
+		if (hugePages)
+		{
+			madvise(ptr, size, MADV_HUGEPAGE);
+		}
+#endif
+
+		if (placement & PLACEMENT_FIRST_TOUCH)
+		{
+			FirstTouch(ptr, size, elementSize);
+		}
+
+		return ptr;
+	}
+
+	inline void Free(void* ptr)
+	{
+#if defined(_WIN32)
+		_aligned_free(ptr);
+#else
+		std::free(ptr);
+#endif
+	}
+
+	// standard allocator over Allocate, copies and rebinds keep the placement
+	template <typename T>
+	class Allocator
+	{
+	public:
+		typedef T value_type;
+
+		Allocator(const uint32_t placement = PLACEMENT_ALIGNED) noexcept
+			: m_placement(placement)
+		{
+		}
+
+		template <typename U>
+		Allocator(const Allocator<U>& other) noexcept
+			: m_placement(other.GetPlacement())
+		{
+		}
+
+		T* allocate(const size_t count)
+		{
+			if (count > std::numeric_limits<size_t>::max() / sizeof(T))
+			{
+				throw std::bad_array_new_length();
+			}
+
+			void* ptr = Allocate(count * sizeof(T), m_placement, sizeof(T));
+			if (!ptr)
+			{
+				throw std::bad_alloc();
+			}
+
+			return static_cast<T*>(ptr);
+		}
+
+		void deallocate(T* ptr, size_t) noexcept
+		{
+			Free(ptr);
+		}
+
+		uint32_t GetPlacement() const noexcept { return m_placement; }
+
+		template <typename U>
+		bool operator==(const Allocator<U>& other) const noexcept { return m_placement == other.GetPlacement(); }
+
+	private:
+		uint32_t m_placement;
+	};
+
+	template <typename T>
+	using Vector = std::vector<T, Allocator<T>>;
+}
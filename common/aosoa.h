@@ -0,0 +1,178 @@
+// Copyright(c) 2024, Pete Brubaker <pete.brubaker@intel.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// ISPC: Making CPU SIMD fun while tracing rays!
+//
+// Graphics Programming Conference 2024
+// https://www.graphicsprogrammingconference.nl/
+//
+// Array of Structures of Arrays container, shared by the parts that hand AoSoA
+// data to ISPC kernels.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace Types
+{
+	// Array of Structures of Arrays
+	// Blocks of Width x's, then Width y's, then Width z's (one component row per
+	// member of T), which is exactly a varying struct for an ISPC gang of Width.
+	// Storage is contiguous and cache line aligned, unused lanes in the last block
+	// are zero, and Data() can be handed straight to the ISPC kernels.
+	template <typename T, size_t Width, typename Scalar = float>
+	class AoSoA
+	{
+		static_assert(std::is_trivially_copyable_v<T> && sizeof(T) % sizeof(Scalar) == 0, "T must be a plain struct of Scalars");
+
+	public:
+		static constexpr size_t COMPONENTS = sizeof(T) / sizeof(Scalar);
+		static constexpr size_t BLOCK_SCALARS = COMPONENTS * Width;
+		static constexpr size_t ALIGNMENT = 64;
+
+		AoSoA() = default;
+
+		explicit AoSoA(size_t count)
+		{
+			Resize(count);
+		}
+
+		AoSoA(const AoSoA& other)
+		{
+			Resize(other.m_count);
+			std::memcpy(m_data.get(), other.m_data.get(), ScalarCount() * sizeof(Scalar));
+		}
+
+		AoSoA& operator=(const AoSoA& other)
+		{
+			if (this != &other)
+			{
+				Resize(other.m_count);
+				std::memcpy(m_data.get(), other.m_data.get(), ScalarCount() * sizeof(Scalar));
+			}
+			return *this;
+		}
+
+		// the source is left empty, not holding a count with no data
+		AoSoA(AoSoA&& other) noexcept
+			: m_data(std::move(other.m_data))
+			, m_count(other.m_count)
+		{
+			other.m_count = 0;
+		}
+
+		AoSoA& operator=(AoSoA&& other) noexcept
+		{
+			if (this != &other)
+			{
+				m_count = other.m_count;
+				m_data = std::move(other.m_data);
+				other.m_count = 0;
+			}
+			return *this;
+		}
+
+		// reallocates and zero fills
+		void Resize(size_t count)
+		{
+			m_count = count;
+			m_data.reset(static_cast<Scalar*>(::operator new(ScalarCount() * sizeof(Scalar), std::align_val_t(ALIGNMENT))));
+			std::memset(m_data.get(), 0, ScalarCount() * sizeof(Scalar));
+		}
+
+		size_t Size() const { return m_count; }
+		size_t BlockCount() const { return (m_count + Width - 1) / Width; }
+		size_t ScalarCount() const { return BlockCount() * BLOCK_SCALARS; }
+
+		Scalar* Data() { return m_data.get(); }
+		const Scalar* Data() const { return m_data.get(); }
+
+		// component c of element i
+		Scalar& Component(size_t i, size_t c) { return m_data[Index(i, c)]; }
+		const Scalar& Component(size_t i, size_t c) const { return m_data[Index(i, c)]; }
+
+		T Get(size_t i) const
+		{
+			Scalar components[COMPONENTS];
+			for (size_t c = 0; c < COMPONENTS; ++c)
+			{
+				components[c] = m_data[Index(i, c)];
+			}
+
+			T value;
+			std::memcpy(&value, components, sizeof(T));
+			return value;
+		}
+
+		void Set(size_t i, const T& value)
+		{
+			Scalar components[COMPONENTS];
+			std::memcpy(components, &value, sizeof(T));
+
+			for (size_t c = 0; c < COMPONENTS; ++c)
+			{
+				m_data[Index(i, c)] = components[c];
+			}
+		}
+
+		// set every element in order from generator()
+		template <typename Generator>
+		void Fill(Generator&& generator)
+		{
+			for (size_t i = 0; i < m_count; ++i)
+			{
+				Set(i, generator());
+			}
+		}
+
+		// copy from a packed array of structures
+		void Assign(const T* src, size_t count)
+		{
+			Resize(count);
+			for (size_t i = 0; i < count; ++i)
+			{
+				Set(i, src[i]);
+			}
+		}
+
+	private:
+		static size_t Index(size_t i, size_t c)
+		{
+			return (i / Width) * BLOCK_SCALARS + c * Width + (i % Width);
+		}
+
+		struct AlignedDelete
+		{
+			void operator()(Scalar* ptr) const
+			{
+				::operator delete(ptr, std::align_val_t(ALIGNMENT));
+			}
+		};
+
+		std::unique_ptr<Scalar[], AlignedDelete> m_data;
+		size_t m_count = 0;
+	};
+}
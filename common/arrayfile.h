@@ -0,0 +1,484 @@
+// Copyright(c) 2024, Pete Brubaker <pete.brubaker@intel.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// ISPC: Making CPU SIMD fun while tracing rays!
+//
+// Graphics Programming Conference 2024
+// https://www.graphicsprogrammingconference.nl/
+//
+// Binary Array Files
+//
+// A 64 byte header followed by the elements, starting at a page aligned
+// offset. MappedArray maps a file read-only and hands out a page aligned
+// pointer to the payload, which can go straight to the ISPC kernels without a
+// copy. Read is the read() into a vector equivalent, and ChunkStream reads a
+// file of any size through a few fixed buffers on a reader thread. Mapping and
+// reading are POSIX only; on other platforms they return false.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ArrayFile
+{
+	static constexpr char MAGIC[8] = { 'I', 'S', 'P', 'C', 'A', 'R', 'R', 0 };
+	static constexpr uint32_t VERSION = 1;
+
+	// payload offset alignment, a multiple of the page size on every platform we run on
+	static constexpr uint64_t PAYLOAD_ALIGNMENT = 4096;
+
+	enum ElementType : uint32_t
+	{
+		ELEMENT_FLOAT32 = 1,
+	};
+
+	struct Header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t elementType;
+		uint32_t elementSize;
+		uint32_t reserved0;
+		uint64_t count;
+		uint64_t payloadOffset;
+		uint8_t reserved[24];
+	};
+	static_assert(sizeof(Header) == 64, "the header is part of the file format");
+
+	inline bool IsValid(const Header& header, const uint64_t fileSize)
+	{
+		return std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 &&
+			header.version == VERSION &&
+			header.elementType == ELEMENT_FLOAT32 &&
+			header.elementSize == sizeof(float) &&
+			header.payloadOffset % PAYLOAD_ALIGNMENT == 0 &&
+			header.payloadOffset >= sizeof(Header) &&
+			header.payloadOffset <= fileSize &&
+			header.count <= (fileSize - header.payloadOffset) / sizeof(float);
+	}
+
+	inline bool Write(const char* path, const float* data, const uint64_t count)
+	{
+		Header header = {};
+		std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+		header.version = VERSION;
+		header.elementType = ELEMENT_FLOAT32;
+		header.elementSize = sizeof(float);
+		header.count = count;
+		header.payloadOffset = PAYLOAD_ALIGNMENT;
+
+		FILE* file = std::fopen(path, "wb");
+		if (!file)
+		{
+			std::fprintf(stderr, "%s: %s\n", path, std::strerror(errno));
+			return false;
+		}
+
+		static const uint8_t padding[PAYLOAD_ALIGNMENT - sizeof(Header)] = {};
+
+		const bool written = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+			std::fwrite(padding, sizeof(padding), 1, file) == 1 &&
+			std::fwrite(data, sizeof(float), count, file) == count;
+
+		if (std::fclose(file) != 0 || !written)
+		{
+			std::fprintf(stderr, "%s: write failed\n", path);
+			return false;
+		}
+
+		return true;
+	}
+
+#if defined(__unix__) || defined(__APPLE__)
+	inline bool ReadFully(const int fd, void* output, uint64_t bytes, uint64_t offset)
+	{
+		char* data = static_cast<char*>(output);
+
+		while (bytes > 0)
+		{
+			const ssize_t read = pread(fd, data, bytes, static_cast<off_t>(offset));
+			if (read <= 0)
+			{
+				return false;
+			}
+
+			data += read;
+			bytes -= static_cast<uint64_t>(read);
+			offset += static_cast<uint64_t>(read);
+		}
+
+		return true;
+	}
+
+	// open path and validate its header, returns -1 on failure
+	inline int OpenArrayFile(const char* path, Header& header)
+	{
+		const int fd = open(path, O_RDONLY);
+		if (fd < 0)
+		{
+			std::fprintf(stderr, "%s: %s\n", path, std::strerror(errno));
+			return -1;
+		}
+
+		struct stat info;
+
+		if (fstat(fd, &info) != 0 ||
+			pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+			!IsValid(header, static_cast<uint64_t>(info.st_size)))
+		{
+			std::fprintf(stderr, "%s: not a valid array file\n", path);
+			close(fd);
+			return -1;
+		}
+
+		return fd;
+	}
+#endif
+
+	// read the whole payload into array with read()
+	inline bool Read(const char* path, std::vector<float>& array)
+	{
+#if defined(__unix__) || defined(__APPLE__)
+		Header header;
+
+		const int fd = OpenArrayFile(path, header);
+		if (fd < 0)
+		{
+			return false;
+		}
+
+		array.resize(header.count);
+		const bool valid = ReadFully(fd, array.data(), header.count * sizeof(float), header.payloadOffset);
+
+		close(fd);
+
+		if (!valid)
+		{
+			std::fprintf(stderr, "%s: read failed\n", path);
+		}
+
+		return valid;
+#else
+		(void)path;
+		(void)array;
+		return false;
+#endif
+	}
+
+	// evict the file from the page cache, so the next read comes from the disk
+	// only clean pages can be dropped, Linux only
+	inline bool DropFromPageCache(const char* path)
+	{
+#if defined(__linux__)
+		const int fd = open(path, O_RDONLY);
+		if (fd < 0)
+		{
+			return false;
+		}
+
+		const bool dropped = fdatasync(fd) == 0 && posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+
+		close(fd);
+		return dropped;
+#else
+		(void)path;
+		return false;
+#endif
+	}
+
+	class MappedArray
+	{
+	public:
+		// madvise hints for the payload
+		enum Advice
+		{
+			ADVICE_NORMAL,
+			ADVICE_SEQUENTIAL,          // read ahead aggressively and drop pages behind the reader
+			ADVICE_SEQUENTIAL_WILLNEED, // also start reading the whole payload in right away
+		};
+
+		MappedArray() = default;
+		MappedArray(const MappedArray&) = delete;
+		MappedArray& operator=(const MappedArray&) = delete;
+
+		~MappedArray()
+		{
+			Close();
+		}
+
+		bool Open(const char* path, const Advice advice = ADVICE_SEQUENTIAL)
+		{
+			Close();
+
+#if defined(__unix__) || defined(__APPLE__)
+			const int fd = open(path, O_RDONLY);
+			if (fd < 0)
+			{
+				std::fprintf(stderr, "%s: %s\n", path, std::strerror(errno));
+				return false;
+			}
+
+			struct stat info;
+			if (fstat(fd, &info) == 0 && static_cast<uint64_t>(info.st_size) >= sizeof(Header))
+			{
+				m_size = static_cast<size_t>(info.st_size);
+				m_mapping = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+
+				if (m_mapping == MAP_FAILED)
+				{
+					m_mapping = nullptr;
+				}
+			}
+
+			// the mapping keeps the file alive
+			close(fd);
+
+			if (!m_mapping || !IsValid(GetHeader(), m_size))
+			{
+				std::fprintf(stderr, "%s: not a valid array file\n", path);
+				Close();
+				return false;
+			}
+
+			if (advice != ADVICE_NORMAL)
+			{
+				madvise(m_mapping, m_size, MADV_SEQUENTIAL);
+			}
+
+			if (advice == ADVICE_SEQUENTIAL_WILLNEED)
+			{
+				madvise(m_mapping, m_size, MADV_WILLNEED);
+			}
+
+			return true;
+#else
+			(void)path;
+			(void)advice;
+			return false;
+#endif
+		}
+
+		void Close()
+		{
+#if defined(__unix__) || defined(__APPLE__)
+			if (m_mapping)
+			{
+				munmap(m_mapping, m_size);
+			}
+#endif
+			m_mapping = nullptr;
+			m_size = 0;
+		}
+
+		bool IsOpen() const { return m_mapping != nullptr; }
+
+		const Header& GetHeader() const { return *static_cast<const Header*>(m_mapping); }
+
+		// page aligned
+		const float* Data() const
+		{
+			return reinterpret_cast<const float*>(static_cast<const char*>(m_mapping) + GetHeader().payloadOffset);
+		}
+
+		size_t Size() const { return static_cast<size_t>(GetHeader().count); }
+
+	private:
+		void* m_mapping = nullptr;
+		size_t m_size = 0;
+	};
+
+	// Streams the payload of an array file through a fixed ring of chunk buffers. A reader thread
+	// fills the buffers in file order while the calling thread consumes them, so with two or more
+	// buffers the reads overlap the work done on each chunk, and with one they take turns.
+	// Memory use is bufferCount chunks, whatever the size of the file.
+	class ChunkStream
+	{
+	public:
+		ChunkStream(const size_t chunkElements, const int bufferCount)
+			: m_chunkElements(chunkElements)
+			, m_buffers(static_cast<size_t>(bufferCount < 1 ? 1 : bufferCount))
+		{
+			// value-initialized, so the pages are touched up front
+			for (Buffer& buffer : m_buffers)
+			{
+				buffer.data.resize(chunkElements);
+			}
+		}
+
+		ChunkStream(const ChunkStream&) = delete;
+		ChunkStream& operator=(const ChunkStream&) = delete;
+
+		// calls consume(const float* chunk, size_t count) for every chunk in file order,
+		// returns false if the file couldn't be opened or read. If consume throws, the
+		// reader is stopped and joined before the exception leaves Run.
+		template <typename Consume>
+		bool Run(const char* path, Consume&& consume)
+		{
+#if defined(__unix__) || defined(__APPLE__)
+			Header header;
+
+			const int fd = OpenArrayFile(path, header);
+			if (fd < 0)
+			{
+				return false;
+			}
+
+#if defined(__linux__)
+			posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+			const uint64_t count = header.count;
+			const uint64_t chunkCount = (count + m_chunkElements - 1) / m_chunkElements;
+
+			bool failed = false;
+			bool stop = false;
+
+			for (Buffer& buffer : m_buffers)
+			{
+				buffer.full = false;
+			}
+
+			// stops and joins the reader however the consuming loop is left, so a throwing
+			// consume doesn't unwind past a joinable thread blocked on a full buffer
+			struct Join
+			{
+				ChunkStream& stream;
+				std::thread& reader;
+				bool& stop;
+				const int fd;
+
+				~Join()
+				{
+					{
+						std::lock_guard<std::mutex> lock(stream.m_mutex);
+						stop = true;
+					}
+					stream.m_condition.notify_all();
+
+					reader.join();
+					close(fd);
+				}
+			};
+
+			std::thread reader([&]
+			{
+				for (uint64_t chunk = 0; chunk < chunkCount; ++chunk)
+				{
+					Buffer& buffer = m_buffers[chunk % m_buffers.size()];
+
+					{
+						std::unique_lock<std::mutex> lock(m_mutex);
+						m_condition.wait(lock, [&] { return !buffer.full || stop; });
+
+						if (stop)
+						{
+							return;
+						}
+					}
+
+					const uint64_t first = chunk * m_chunkElements;
+					const size_t elements = static_cast<size_t>(std::min<uint64_t>(m_chunkElements, count - first));
+					const bool read = ReadFully(fd, buffer.data.data(), elements * sizeof(float), header.payloadOffset + first * sizeof(float));
+
+					{
+						std::lock_guard<std::mutex> lock(m_mutex);
+						buffer.count = elements;
+						buffer.full = read;
+						failed = !read;
+					}
+					m_condition.notify_all();
+
+					if (!read)
+					{
+						return;
+					}
+				}
+			});
+
+			{
+				Join join = { *this, reader, stop, fd };
+
+				for (uint64_t chunk = 0; chunk < chunkCount; ++chunk)
+				{
+					Buffer& buffer = m_buffers[chunk % m_buffers.size()];
+
+					{
+						std::unique_lock<std::mutex> lock(m_mutex);
+						m_condition.wait(lock, [&] { return buffer.full || failed; });
+
+						if (!buffer.full)
+						{
+							break;
+						}
+					}
+
+					consume(static_cast<const float*>(buffer.data.data()), buffer.count);
+
+					{
+						std::lock_guard<std::mutex> lock(m_mutex);
+						buffer.full = false;
+					}
+					m_condition.notify_all();
+				}
+			}
+
+			if (failed)
+			{
+				std::fprintf(stderr, "%s: read failed\n", path);
+			}
+
+			return !failed;
+#else
+			(void)path;
+			(void)consume;
+			return false;
+#endif
+		}
+
+	private:
+		struct Buffer
+		{
+			std::vector<float> data;
+			size_t count = 0;
+			bool full = false;
+		};
+
+		const size_t m_chunkElements;
+		std::vector<Buffer> m_buffers;
+		std::mutex m_mutex;
+		std::condition_variable m_condition;
+	};
+}
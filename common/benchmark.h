@@ -0,0 +1,663 @@
+// Copyright(c) 2024, Pete Brubaker <pete.brubaker@intel.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// ISPC: Making CPU SIMD fun while tracing rays!
+//
+// Graphics Programming Conference 2024
+// https://www.graphicsprogrammingconference.nl/
+//
+// Benchmark Harness
+//
+// Shared picobench setup for the benchmark executables. Include it from the one
+// translation unit that defines main, in place of picobench itself.
+//
+// Dim is the problem size in elements, swept from 4KB (L1) up to 128MB (DRAM)
+// of floats. Each sample repeats the kernel Bench::Repetitions(s) times, so every
+// sample touches about the same number of elements whatever its size. Results
+// are reported as ns/element and GB/s from the bytes a benchmark moves per
+// element, registered alongside it with PICOBENCH_THROUGHPUT.
+//
+// Benchmarks time their kernels with Bench::StartTimer / Bench::StopTimer. With
+// --perf those also collect hardware performance counters, and the fastest
+// sample's counts are added to the report per element.
+//
+// --ispc-target=<isa> calls that ISPC target instead of the dispatcher, and
+// --ispc-target=all runs everything once per target the host supports.
+//
+// Work that isn't measured in bytes, like ray-triangle tests, can add a Mops/s
+// column with Bench::SetOpsPerElement. Kernels much slower than a pass over
+// memory pass their own elements per sample to Bench::Repetitions, and
+// Bench::SetWorkingSet reports a footprint that doesn't scale with Dim.
+//
+
+#pragma once
+
+#define PICOBENCH_IMPLEMENT
+#define PICOBENCH_STD_FUNCTION_BENCHMARKS // benchmarks are wrapped to record their name
+#define PICOBENCH_DONT_BIND_TO_ONE_CORE // the task benchmarks need every core
+#define PICOBENCH_DEFAULT_ITERATIONS {1 << 10, 1 << 13, 1 << 16, 1 << 19, 1 << 22, 1 << 25}
+#include "picobench/picobench.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "ispc_targets.h"
+#include "perfcounters.h"
+
+namespace Bench
+{
+	// elements touched per sample, sizes above this run once
+	static constexpr int64_t ELEMENTS_PER_SAMPLE = 1 << 25;
+
+	// bytes read and written per element, keyed by benchmark name
+	inline std::map<std::string, double>& BytesPerElement()
+	{
+		static std::map<std::string, double> bytes;
+		return bytes;
+	}
+
+	inline int SetBytesPerElement(const char* name, const double bytes)
+	{
+		BytesPerElement()[name] = bytes;
+		return 0;
+	}
+
+	// name of the benchmark that is running right now
+	inline const char*& CurrentBenchmark()
+	{
+		static const char* name = "";
+		return name;
+	}
+
+	// elements per sample of the benchmarks that set their own, keyed by benchmark name
+	inline std::map<std::string, int64_t>& ElementsPerSample()
+	{
+		static std::map<std::string, int64_t> elements;
+		return elements;
+	}
+
+	// how many times a benchmark runs its kernel in one sample
+	inline int Repetitions(const char* name, const int64_t count)
+	{
+		const auto elements = ElementsPerSample().find(name);
+		const int64_t perSample = elements == ElementsPerSample().end() ? ELEMENTS_PER_SAMPLE : elements->second;
+
+		return static_cast<int>(std::max<int64_t>(1, perSample / count));
+	}
+
+	inline int Repetitions(const picobench::state& s)
+	{
+		return Repetitions(CurrentBenchmark(), s.iterations());
+	}
+
+	// for kernels far slower per element than a pass over memory, like building a BVH,
+	// sizes above elementsPerSample run once
+	inline int Repetitions(const picobench::state& s, const int64_t elementsPerSample)
+	{
+		ElementsPerSample()[CurrentBenchmark()] = elementsPerSample;
+		return Repetitions(s);
+	}
+
+	inline picobench::benchmark& Register(const char* name, void (*proc)(picobench::state&), const double bytes)
+	{
+		SetBytesPerElement(name, bytes);
+
+		return picobench::global_registry::new_benchmark(name, [name, proc](picobench::state& s)
+		{
+			CurrentBenchmark() = name;
+			proc(s);
+		});
+	}
+
+	// hardware counters, only open when --perf was passed and the kernel allows it
+	inline PerfCounters& Counters()
+	{
+		static PerfCounters counters;
+		return counters;
+	}
+
+	struct PerfSample
+	{
+		int64_t durationNs = 0;
+		PerfCounters::Values values;
+	};
+
+	// counters of the fastest sample, keyed by benchmark name and Dim
+	inline std::map<std::pair<std::string, int>, PerfSample>& PerfSamples()
+	{
+		static std::map<std::pair<std::string, int>, PerfSample> samples;
+		return samples;
+	}
+
+	inline void StartTimer(picobench::state& s)
+	{
+		if (Counters().IsOpen())
+		{
+			Counters().Start();
+		}
+
+		s.start_timer();
+	}
+
+	inline void StopTimer(picobench::state& s)
+	{
+		s.stop_timer();
+
+		if (Counters().IsOpen())
+		{
+			const PerfCounters::Values values = Counters().Stop();
+
+			PerfSample& sample = PerfSamples()[{ CurrentBenchmark(), s.iterations() }];
+			if (sample.durationNs == 0 || s.duration_ns() < sample.durationNs)
+			{
+				sample.durationNs = s.duration_ns();
+				sample.values = values;
+			}
+		}
+	}
+
+	// relative error of a benchmark's result against a reference, keyed by benchmark name and Dim
+	inline std::map<std::pair<std::string, int>, double>& Errors()
+	{
+		static std::map<std::pair<std::string, int>, double> errors;
+		return errors;
+	}
+
+	// adds a relative error column to the report of the current benchmark
+	inline void SetError(const picobench::state& s, const double result, const long double reference)
+	{
+		const long double error = std::fabs(static_cast<long double>(result) - reference);
+		Errors()[{ CurrentBenchmark(), s.iterations() }] = static_cast<double>(reference != 0 ? error / std::fabs(reference) : error);
+	}
+
+	// register a task benchmark once per thread count (1, 2, 4 ... every hardware thread)
+	// the thread count is handed to the benchmark as its user data
+	inline int RegisterThreadSweep(const char* name, void (*proc)(picobench::state&), const double bytes)
+	{
+		static std::deque<std::string> labels;
+
+		const int maxThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+
+		for (int threads = 1; ; threads = std::min(threads * 2, maxThreads))
+		{
+			labels.push_back(std::string(name) + "_T" + std::to_string(threads));
+			Register(labels.back().c_str(), proc, bytes).user_data(threads);
+
+			if (threads == maxThreads)
+			{
+				break;
+			}
+		}
+
+		return 0;
+	}
+
+	struct Throughput
+	{
+		int64_t elements;
+		double nsPerElement;
+		double gbPerSecond;
+	};
+
+	inline Throughput GetThroughput(const char* name, const int dimension, const int64_t totalTimeNs)
+	{
+		const auto bytes = BytesPerElement().find(name);
+		const int64_t elements = static_cast<int64_t>(dimension) * Repetitions(name, dimension);
+		const double ns = static_cast<double>(std::max<int64_t>(1, totalTimeNs));
+
+		Throughput result;
+		result.elements = elements;
+		result.nsPerElement = ns / static_cast<double>(elements);
+		result.gbPerSecond = bytes == BytesPerElement().end() ? 0.0 : bytes->second * static_cast<double>(elements) / ns;
+		return result;
+	}
+
+	// operations per element, keyed by benchmark name and Dim
+	inline std::map<std::pair<std::string, int>, double>& OpsPerElement()
+	{
+		static std::map<std::pair<std::string, int>, double> ops;
+		return ops;
+	}
+
+	// adds a millions of operations per second column to the report of the current benchmark,
+	// for work that isn't counted in bytes (ray-triangle tests, rays)
+	inline void SetOpsPerElement(const picobench::state& s, const double ops)
+	{
+		OpsPerElement()[{ CurrentBenchmark(), s.iterations() }] = ops;
+	}
+
+	inline double MopsPerSecond(const char* name, const int dimension, const int64_t totalTimeNs)
+	{
+		const auto ops = OpsPerElement().find({ name, dimension });
+		if (ops == OpsPerElement().end())
+		{
+			return 0.0;
+		}
+
+		const Throughput throughput = GetThroughput(name, dimension, totalTimeNs);
+		return ops->second * 1e3 / throughput.nsPerElement;
+	}
+
+	// working set bytes, keyed by benchmark name and Dim
+	inline std::map<std::pair<std::string, int>, double>& WorkingSets()
+	{
+		static std::map<std::pair<std::string, int>, double> bytes;
+		return bytes;
+	}
+
+	// reports bytes as the working set of the current benchmark instead of Dim times its bytes per element,
+	// for data that isn't proportional to Dim (the memory footprint of a BVH)
+	inline void SetWorkingSet(const picobench::state& s, const double bytes)
+	{
+		WorkingSets()[{ CurrentBenchmark(), s.iterations() }] = bytes;
+	}
+
+	// counter columns, per element except IPC
+	static constexpr struct
+	{
+		const char* label;
+		int width;
+	} PERF_COLUMNS[] = { { "cyc/elem", 9 }, { "ins/elem", 9 }, { "IPC", 6 }, { "L1D miss", 9 }, { "LLC miss", 9 }, { "br miss", 9 } };
+
+	inline void PerfToText(const char* name, const int dimension, std::ostream& out)
+	{
+		using namespace std;
+
+		const auto sample = PerfSamples().find({ name, dimension });
+		if (sample == PerfSamples().end())
+		{
+			for (auto& column : PERF_COLUMNS)
+			{
+				out << " |" << setw(column.width) << "-";
+			}
+			return;
+		}
+
+		const PerfCounters::Values& values = sample->second.values;
+		const double elements = static_cast<double>(dimension) * Repetitions(name, dimension);
+
+		auto column = [&](const int width, const bool valid, const double value)
+		{
+			out << " |";
+			if (valid)
+			{
+				out << setw(width) << fixed << setprecision(3) << value;
+			}
+			else
+			{
+				out << setw(width) << "-";
+			}
+		};
+
+		column(PERF_COLUMNS[0].width, values.valid[PerfCounters::CYCLES], values.counts[PerfCounters::CYCLES] / elements);
+		column(PERF_COLUMNS[1].width, values.valid[PerfCounters::INSTRUCTIONS], values.counts[PerfCounters::INSTRUCTIONS] / elements);
+		column(PERF_COLUMNS[2].width, values.valid[PerfCounters::CYCLES] && values.valid[PerfCounters::INSTRUCTIONS] && values.counts[PerfCounters::CYCLES] > 0,
+			values.counts[PerfCounters::INSTRUCTIONS] / values.counts[PerfCounters::CYCLES]);
+		column(PERF_COLUMNS[3].width, values.valid[PerfCounters::L1D_MISSES], values.counts[PerfCounters::L1D_MISSES] / elements);
+		column(PERF_COLUMNS[4].width, values.valid[PerfCounters::LLC_MISSES], values.counts[PerfCounters::LLC_MISSES] / elements);
+		column(PERF_COLUMNS[5].width, values.valid[PerfCounters::BRANCH_MISSES], values.counts[PerfCounters::BRANCH_MISSES] / elements);
+	}
+
+	inline void ToText(const picobench::report& report, std::ostream& out)
+	{
+		using namespace std;
+
+		const bool perf = !PerfSamples().empty();
+
+		for (auto& suite : report.suites)
+		{
+			if (suite.name)
+			{
+				out << "## " << suite.name << ":\n";
+			}
+
+			// wide enough for the longest name plus the baseline marker
+			size_t nameWidth = 36;
+			bool errors = false;
+			bool ops = false;
+			for (auto& bm : suite.benchmarks)
+			{
+				nameWidth = max(nameWidth, strlen(bm.name) + 4);
+
+				for (auto& d : bm.data)
+				{
+					errors = errors || Errors().count({ bm.name, d.dimension }) != 0;
+					ops = ops || OpsPerElement().count({ bm.name, d.dimension }) != 0;
+				}
+			}
+
+			string header = " Name (* = baseline)";
+			header.resize(nameWidth, ' ');
+
+			out.put('\n');
+			out << header <<
+				"|    Dim    | Reps  | Working set | ns/element |   GB/s  | Baseline";
+			if (errors)
+			{
+				out << " | Rel. error";
+			}
+			if (ops)
+			{
+				out << " |    Mops/s";
+			}
+			if (perf)
+			{
+				for (auto& column : PERF_COLUMNS)
+				{
+					out << " |" << setw(column.width) << column.label;
+				}
+			}
+			out.put('\n');
+
+			out << string(nameWidth, '-') <<
+				"|----------:|------:|------------:|-----------:|--------:|--------:";
+			if (errors)
+			{
+				out << "|-----------:";
+			}
+			if (ops)
+			{
+				out << "|----------:";
+			}
+			if (perf)
+			{
+				for (auto& column : PERF_COLUMNS)
+				{
+					out << '|' << string(column.width, '-') << ':';
+				}
+			}
+			out.put('\n');
+
+			for (auto& ps : picobench::report::get_problem_space_view(suite))
+			{
+				const picobench::report::problem_space_benchmark* baseline = nullptr;
+				for (auto& bm : ps.second)
+				{
+					if (bm.is_baseline)
+					{
+						baseline = &bm;
+						break;
+					}
+				}
+
+				for (auto& bm : ps.second)
+				{
+					const Throughput throughput = GetThroughput(bm.name, ps.first, bm.total_time_ns);
+					const auto bytes = BytesPerElement().find(bm.name);
+
+					string name = string(" ") + bm.name + (bm.is_baseline ? " *" : "");
+					name.resize(nameWidth, ' ');
+					out << name << "|";
+
+					out << setw(10) << ps.first << " |" << setw(6) << Repetitions(bm.name, ps.first) << " |";
+
+					const auto workingSet = WorkingSets().find({ bm.name, ps.first });
+					if (workingSet != WorkingSets().end())
+					{
+						out << setw(9) << fixed << setprecision(1) << workingSet->second / 1024.0 << " KB |";
+					}
+					else if (bytes != BytesPerElement().end())
+					{
+						out << setw(9) << fixed << setprecision(1) << bytes->second * ps.first / 1024.0 << " KB |";
+					}
+					else
+					{
+						out << "           - |";
+					}
+
+					out << setw(11) << fixed << setprecision(3) << throughput.nsPerElement << " |"
+						<< setw(8) << fixed << setprecision(2) << throughput.gbPerSecond << " |";
+
+					if (baseline == &bm)
+					{
+						out << "       -";
+					}
+					else if (baseline)
+					{
+						out << setw(8) << fixed << setprecision(3) << double(bm.total_time_ns) / double(baseline->total_time_ns);
+					}
+					else
+					{
+						out << "     ???";
+					}
+
+					if (errors)
+					{
+						const auto error = Errors().find({ bm.name, ps.first });
+						if (error != Errors().end())
+						{
+							out << " |" << setw(11) << scientific << setprecision(3) << error->second;
+						}
+						else
+						{
+							out << " |          -";
+						}
+					}
+
+					if (ops)
+					{
+						if (OpsPerElement().count({ bm.name, ps.first }) != 0)
+						{
+							out << " |" << setw(10) << fixed << setprecision(2) << MopsPerSecond(bm.name, ps.first, bm.total_time_ns);
+						}
+						else
+						{
+							out << " |         -";
+						}
+					}
+
+					if (perf)
+					{
+						PerfToText(bm.name, ps.first, out);
+					}
+
+					out.put('\n');
+				}
+			}
+			out.put('\n');
+		}
+	}
+
+	inline void ToCsv(const picobench::report& report, std::ostream& out, const bool header)
+	{
+		if (header)
+		{
+			out << "Target,Suite,Benchmark,Dim,Reps,Total ns,ns/element,GB/s,Cycles,Instructions,L1D misses,LLC misses,Branch misses,Relative error,Mops/s,Working set bytes\n";
+		}
+
+		for (auto& suite : report.suites)
+		{
+			for (auto& bm : suite.benchmarks)
+			{
+				for (auto& d : bm.data)
+				{
+					const Throughput throughput = GetThroughput(bm.name, d.dimension, d.total_time_ns);
+
+					out << SelectedIspcTargetName() << ",\"" << (suite.name ? suite.name : "") << "\",\"" << bm.name << "\","
+						<< d.dimension << ',' << Repetitions(bm.name, d.dimension) << ',' << d.total_time_ns << ','
+						<< throughput.nsPerElement << ',' << throughput.gbPerSecond;
+
+					// raw counts of the fastest sample, empty when a counter wasn't available
+					const auto sample = PerfSamples().find({ bm.name, d.dimension });
+					for (int i = 0; i < PerfCounters::COUNTER_COUNT; ++i)
+					{
+						out << ',';
+						if (sample != PerfSamples().end() && sample->second.values.valid[i])
+						{
+							out << static_cast<int64_t>(sample->second.values.counts[i]);
+						}
+					}
+
+					out << ',';
+					const auto error = Errors().find({ bm.name, d.dimension });
+					if (error != Errors().end())
+					{
+						out << error->second;
+					}
+
+					out << ',';
+					if (OpsPerElement().count({ bm.name, d.dimension }) != 0)
+					{
+						out << MopsPerSecond(bm.name, d.dimension, d.total_time_ns);
+					}
+
+					out << ',';
+					const auto workingSet = WorkingSets().find({ bm.name, d.dimension });
+					if (workingSet != WorkingSets().end())
+					{
+						out << static_cast<int64_t>(workingSet->second);
+					}
+
+					out << '\n';
+				}
+			}
+		}
+	}
+
+	// picobench main, reporting throughput instead of ns/op
+	// gangWidth returns GetProgramCount() of a target, or 0 if that target isn't linked
+	// addOptions can register options of its own with add_cmd_opt before the command line is parsed
+	inline int Main(int argc, char* argv[], int (*gangWidth)(int target), void (*addOptions)(picobench::runner&) = nullptr)
+	{
+		static bool perf = false;
+		static const char* ispcTarget = nullptr;
+
+		picobench::runner r;
+		r.add_cmd_opt("-perf", "", "Collects hardware performance counters (Linux perf_event_open)", [](uintptr_t, const char* arg)
+		{
+			perf = true;
+			return *arg == 0;
+		});
+		r.add_cmd_opt("-ispc-target=", "<isa|all>", "Calls one compiled ISPC target, or each one the host supports", [](uintptr_t, const char* arg)
+		{
+			ispcTarget = arg;
+			return *arg != 0;
+		});
+		if (addOptions)
+		{
+			addOptions(r);
+		}
+		r.parse_cmd_line(argc, argv);
+
+		if (!r.should_run())
+		{
+			return r.error();
+		}
+
+		// ISPC targets to run the benchmarks with, -1 is ISPC's own dispatch
+		std::vector<int> targets;
+		if (!ispcTarget)
+		{
+			targets.push_back(-1);
+		}
+		else
+		{
+			for (int i = 0; i < IspcTargetCount(); ++i)
+			{
+				const bool requested = strcmp(ispcTarget, "all") == 0 || strcmp(ispcTarget, IspcTargetNames()[i]) == 0;
+
+				if (requested && HostSupportsIspcTarget(IspcTargetNames()[i]) && gangWidth(i) > 0)
+				{
+					targets.push_back(i);
+				}
+			}
+
+			if (targets.empty())
+			{
+				std::cerr << "Error: ISPC target `" << ispcTarget << "` is not available. Compiled targets:";
+				for (int i = 0; i < IspcTargetCount(); ++i)
+				{
+					std::cerr << ' ' << IspcTargetNames()[i];
+					if (!HostSupportsIspcTarget(IspcTargetNames()[i]))
+					{
+						std::cerr << " (unsupported by host)";
+					}
+					else if (gangWidth(i) <= 0)
+					{
+						std::cerr << " (not linked)";
+					}
+				}
+				std::cerr << '\n';
+				return 1;
+			}
+		}
+
+		// opened before any task system threads exist, so they inherit the counters
+		if (perf && !Counters().Open())
+		{
+			std::cerr << "Warning: hardware performance counters are unavailable (see /proc/sys/kernel/perf_event_paranoid), reporting wall time only\n";
+		}
+
+		std::ostream* out = &std::cout;
+		std::ofstream fout;
+		if (r.preferred_output_filename())
+		{
+			fout.open(r.preferred_output_filename());
+			if (!fout.is_open())
+			{
+				std::cerr << "Error: Could not open output file `" << r.preferred_output_filename() << "`\n";
+				return 1;
+			}
+			out = &fout;
+		}
+
+		for (const int target : targets)
+		{
+			SelectedIspcTarget() = target;
+			PerfSamples().clear();
+
+			r.run_benchmarks();
+			const picobench::report report = r.generate_report();
+
+			if (r.preferred_output_format() == picobench::report_output_format::csv)
+			{
+				ToCsv(report, *out, target == targets.front());
+			}
+			else
+			{
+				*out << "# ISPC target: " << SelectedIspcTargetName() << ", gang width " << gangWidth(target) << "\n\n";
+				ToText(report, *out);
+			}
+		}
+
+		SelectedIspcTarget() = -1;
+
+		return r.error();
+	}
+}
+
+// a benchmark plus the bytes it reads and writes per element
+#define PICOBENCH_THROUGHPUT(func, bytes) \
+	static auto& I_PICOBENCH_PP_CAT(picobench, PICOBENCH_UNIQUE_SYM_SUFFIX) = Bench::Register(#func, func, bytes)
+
+// a task benchmark at every thread count, see Bench::RegisterThreadSweep
+#define PICOBENCH_THREAD_SWEEP(func, bytes) \
+	static int I_PICOBENCH_PP_CAT(picobench_sweep, PICOBENCH_UNIQUE_SYM_SUFFIX) = Bench::RegisterThreadSweep(#func, func, bytes)
@@ -0,0 +1,235 @@
+// Copyright(c) 2024, Pete Brubaker <pete.brubaker@intel.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// ISPC: Making CPU SIMD fun while tracing rays!
+//
+// Graphics Programming Conference 2024
+// https://www.graphicsprogrammingconference.nl/
+//
+// ISPC Target Selection
+//
+// When a file is compiled for several targets, ISPC emits every exported
+// function once per target with the ISA appended (SumArray_avx2, SumArray_sse4,
+// ...) next to the dispatcher that picks the best one for the host. CMake's
+// ispc_target_definitions() defines ISPC_TARGET_<ISA> for each compiled target,
+// which lets the benchmarks call a specific target instead of the dispatcher:
+//
+//     ISPC_DECLARE_TARGETS(SumArray);                     // once, at file scope
+//     ISPC_KERNEL(SumArray)(output, a.data(), count);     // selected target, or the dispatcher
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+#if defined(ISPC_TARGET_SSE2)
+#define ISPC_TARGET_SSE2_X(X, arg) X(sse2, arg)
+#else
+#define ISPC_TARGET_SSE2_X(X, arg)
+#endif
+
+#if defined(ISPC_TARGET_SSE4)
+#define ISPC_TARGET_SSE4_X(X, arg) X(sse4, arg)
+#else
+#define ISPC_TARGET_SSE4_X(X, arg)
+#endif
+
+#if defined(ISPC_TARGET_AVX)
+#define ISPC_TARGET_AVX_X(X, arg) X(avx, arg)
+#else
+#define ISPC_TARGET_AVX_X(X, arg)
+#endif
+
+#if defined(ISPC_TARGET_AVX2)
+#define ISPC_TARGET_AVX2_X(X, arg) X(avx2, arg)
+#else
+#define ISPC_TARGET_AVX2_X(X, arg)
+#endif
+
+#if defined(ISPC_TARGET_AVX512SKX)
+#define ISPC_TARGET_AVX512SKX_X(X, arg) X(avx512skx, arg)
+#else
+#define ISPC_TARGET_AVX512SKX_X(X, arg)
+#endif
+
+#if defined(ISPC_TARGET_AVX512ICL)
+#define ISPC_TARGET_AVX512ICL_X(X, arg) X(avx512icl, arg)
+#else
+#define ISPC_TARGET_AVX512ICL_X(X, arg)
+#endif
+
+#if defined(ISPC_TARGET_AVX512SPR)
+#define ISPC_TARGET_AVX512SPR_X(X, arg) X(avx512spr, arg)
+#else
+#define ISPC_TARGET_AVX512SPR_X(X, arg)
+#endif
+
+// X(isa, arg) for every compiled target, in ascending order
+#define ISPC_TARGETS(X, arg) \
+	ISPC_TARGET_SSE2_X(X, arg) \
+	ISPC_TARGET_SSE4_X(X, arg) \
+	ISPC_TARGET_AVX_X(X, arg) \
+	ISPC_TARGET_AVX2_X(X, arg) \
+	ISPC_TARGET_AVX512SKX_X(X, arg) \
+	ISPC_TARGET_AVX512ICL_X(X, arg) \
+	ISPC_TARGET_AVX512SPR_X(X, arg)
+
+// a target missing from the link resolves to null instead of failing, where the toolchain allows it
+#if defined(__GNUC__) || defined(__clang__)
+#define ISPC_TARGET_WEAK __attribute__((weak))
+#else
+#define ISPC_TARGET_WEAK
+#endif
+
+#define ISPC_TARGET_NAME(isa, arg) #isa,
+#define ISPC_TARGET_DECLARE(isa, name) extern "C" ISPC_TARGET_WEAK decltype(ispc::name) name##_##isa;
+#define ISPC_TARGET_POINTER(isa, name) &ispc::name##_##isa,
+
+namespace Bench
+{
+	// every compiled target, indexed like the tables ISPC_DECLARE_TARGETS builds
+	inline const char* const* IspcTargetNames()
+	{
+		static const char* const names[] = { ISPC_TARGETS(ISPC_TARGET_NAME, _) nullptr };
+		return names;
+	}
+
+	inline int IspcTargetCount()
+	{
+		int count = 0;
+		while (IspcTargetNames()[count])
+		{
+			++count;
+		}
+		return count;
+	}
+
+	inline int FindIspcTarget(const char* isa)
+	{
+		for (int i = 0; i < IspcTargetCount(); ++i)
+		{
+			if (strcmp(IspcTargetNames()[i], isa) == 0)
+			{
+				return i;
+			}
+		}
+
+		return -1;
+	}
+
+	// target index used by ISPC_KERNEL, -1 goes through ISPC's own dispatch
+	inline int& SelectedIspcTarget()
+	{
+		static int target = -1;
+		return target;
+	}
+
+	inline const char* SelectedIspcTargetName()
+	{
+		return SelectedIspcTarget() >= 0 ? IspcTargetNames()[SelectedIspcTarget()] : "auto";
+	}
+
+	// whether the host can run code compiled for an ISPC target
+	inline bool HostSupportsIspcTarget(const char* isa)
+	{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+		auto cpuid = [](const uint32_t leaf, const uint32_t subleaf, uint32_t regs[4])
+		{
+#if defined(_MSC_VER)
+			int info[4];
+			__cpuidex(info, static_cast<int>(leaf), static_cast<int>(subleaf));
+			for (int i = 0; i < 4; ++i)
+			{
+				regs[i] = static_cast<uint32_t>(info[i]);
+			}
+#else
+			__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+		};
+
+		uint32_t leaf0[4], leaf1[4], leaf7[4] = {}, leaf7_1[4] = {};
+		cpuid(0, 0, leaf0);
+		cpuid(1, 0, leaf1);
+		if (leaf0[0] >= 7)
+		{
+			cpuid(7, 0, leaf7);
+			cpuid(7, 1, leaf7_1);
+		}
+
+		auto bit = [](const uint32_t reg, const int index) { return (reg >> index) & 1u; };
+
+		// the OS has to save the wider register state too
+		uint64_t xcr0 = 0;
+		if (bit(leaf1[2], 27))
+		{
+#if defined(_MSC_VER)
+			xcr0 = _xgetbv(0);
+#else
+			uint32_t eax, edx;
+			__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+			xcr0 = (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+		}
+
+		const bool sse2 = bit(leaf1[3], 26);
+		const bool sse4 = sse2 && bit(leaf1[2], 19) && bit(leaf1[2], 20);
+		const bool avx = sse4 && bit(leaf1[2], 28) && (xcr0 & 0x6) == 0x6;
+		const bool avx2 = avx && bit(leaf7[1], 5) && bit(leaf1[2], 12) && bit(leaf1[2], 29) && bit(leaf7[1], 3) && bit(leaf7[1], 8);
+		const bool skx = avx2 && (xcr0 & 0xE6) == 0xE6 && bit(leaf7[1], 16) && bit(leaf7[1], 17) && bit(leaf7[1], 28) && bit(leaf7[1], 30) && bit(leaf7[1], 31);
+		const bool icl = skx && bit(leaf7[2], 1) && bit(leaf7[2], 6) && bit(leaf7[2], 11) && bit(leaf7[2], 12) && bit(leaf7[2], 14);
+		const bool spr = icl && bit(leaf7[3], 23) && bit(leaf7_1[0], 5);
+
+		if (strcmp(isa, "sse2") == 0) return sse2;
+		if (strcmp(isa, "sse4") == 0) return sse4;
+		if (strcmp(isa, "avx") == 0) return avx;
+		if (strcmp(isa, "avx2") == 0) return avx2;
+		if (strcmp(isa, "avx512skx") == 0) return skx;
+		if (strcmp(isa, "avx512icl") == 0) return icl;
+		if (strcmp(isa, "avx512spr") == 0) return spr;
+#endif
+		(void)isa;
+		return false;
+	}
+}
+
+// per-target entry points of an exported ISPC function
+// IspcTarget_<name>(target) is null if that target isn't linked, -1 returns the dispatcher
+#define ISPC_DECLARE_TARGETS(name) \
+	namespace ispc { ISPC_TARGETS(ISPC_TARGET_DECLARE, name) } \
+	static inline decltype(&ispc::name) IspcTarget_##name(const int target) \
+	{ \
+		static decltype(&ispc::name) const targets[] = { ISPC_TARGETS(ISPC_TARGET_POINTER, name) nullptr }; \
+		return target >= 0 ? targets[target] : &ispc::name; \
+	} \
+	static inline decltype(&ispc::name) IspcKernel_##name() \
+	{ \
+		const auto kernel = IspcTarget_##name(Bench::SelectedIspcTarget()); \
+		return kernel ? kernel : &ispc::name; \
+	} \
+	static_assert(true, "")
+
+#define ISPC_KERNEL(name) IspcKernel_##name()
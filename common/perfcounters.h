@@ -0,0 +1,216 @@
+// Copyright(c) 2024, Pete Brubaker <pete.brubaker@intel.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// ISPC: Making CPU SIMD fun while tracing rays!
+//
+// Graphics Programming Conference 2024
+// https://www.graphicsprogrammingconference.nl/
+//
+// Hardware Performance Counters
+//
+// Thin wrapper over Linux perf_event_open for cycles, instructions, L1D and LLC
+// read misses and branch misses. Counters are opened with inherit set, so
+// threads created after Open are counted too. The kernel folds the counts of
+// exited threads into the counter for good (a reset doesn't clear them), so a
+// sample is the difference between reads at Start and Stop. Every counter is
+// opened on its own: any the kernel refuses are reported as invalid, and on
+// other platforms Open simply returns false.
+//
+
+#pragma once
+
+#include <cstdint>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace Bench
+{
+	class PerfCounters
+	{
+	public:
+		enum Counter
+		{
+			CYCLES,
+			INSTRUCTIONS,
+			L1D_MISSES,
+			LLC_MISSES,
+			BRANCH_MISSES,
+			COUNTER_COUNT
+		};
+
+		struct Values
+		{
+			double counts[COUNTER_COUNT] = {};
+			bool valid[COUNTER_COUNT] = {};
+		};
+
+		PerfCounters() = default;
+		PerfCounters(const PerfCounters&) = delete;
+		PerfCounters& operator=(const PerfCounters&) = delete;
+
+		~PerfCounters()
+		{
+			Close();
+		}
+
+		// open every counter the kernel allows, returns false if there are none
+		bool Open()
+		{
+#if defined(__linux__)
+			const uint64_t l1dReadMiss = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+			const uint64_t llcReadMiss = PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+			m_fds[CYCLES] = OpenCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+			m_fds[INSTRUCTIONS] = OpenCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+			m_fds[L1D_MISSES] = OpenCounter(PERF_TYPE_HW_CACHE, l1dReadMiss);
+			m_fds[LLC_MISSES] = OpenCounter(PERF_TYPE_HW_CACHE, llcReadMiss);
+			m_fds[BRANCH_MISSES] = OpenCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+#endif
+			return IsOpen();
+		}
+
+		void Close()
+		{
+#if defined(__linux__)
+			for (int& fd : m_fds)
+			{
+				if (fd >= 0)
+				{
+					close(fd);
+					fd = -1;
+				}
+			}
+#endif
+		}
+
+		bool IsOpen() const
+		{
+			for (const int fd : m_fds)
+			{
+				if (fd >= 0)
+				{
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		void Start()
+		{
+#if defined(__linux__)
+			for (int i = 0; i < COUNTER_COUNT; ++i)
+			{
+				if (m_fds[i] >= 0)
+				{
+					m_start[i] = Read(m_fds[i]);
+					ioctl(m_fds[i], PERF_EVENT_IOC_ENABLE, 0);
+				}
+			}
+#endif
+		}
+
+		// counts since Start, scaled up if the kernel had to multiplex the counter
+		Values Stop()
+		{
+			Values values;
+#if defined(__linux__)
+			for (const int fd : m_fds)
+			{
+				if (fd >= 0)
+				{
+					ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+				}
+			}
+
+			for (int i = 0; i < COUNTER_COUNT; ++i)
+			{
+				if (m_fds[i] < 0 || !m_start[i].valid)
+				{
+					continue;
+				}
+
+				const Reading stop = Read(m_fds[i]);
+				const uint64_t value = stop.value - m_start[i].value;
+				const uint64_t timeEnabled = stop.timeEnabled - m_start[i].timeEnabled;
+				const uint64_t timeRunning = stop.timeRunning - m_start[i].timeRunning;
+
+				if (stop.valid && timeRunning > 0)
+				{
+					values.counts[i] = static_cast<double>(value) * static_cast<double>(timeEnabled) / static_cast<double>(timeRunning);
+					values.valid[i] = true;
+				}
+			}
+#endif
+			return values;
+		}
+
+	private:
+		// one read of a counter, everything in it counts from Open
+		struct Reading
+		{
+			uint64_t value = 0;
+			uint64_t timeEnabled = 0;
+			uint64_t timeRunning = 0;
+			bool valid = false;
+		};
+
+#if defined(__linux__)
+		static Reading Read(const int fd)
+		{
+			uint64_t data[3] = {};
+
+			Reading reading;
+			if (read(fd, data, sizeof(data)) == sizeof(data))
+			{
+				reading.value = data[0];
+				reading.timeEnabled = data[1];
+				reading.timeRunning = data[2];
+				reading.valid = true;
+			}
+
+			return reading;
+		}
+
+		static int OpenCounter(const uint32_t type, const uint64_t config)
+		{
+			perf_event_attr attr = {};
+			attr.size = sizeof(attr);
+			attr.type = type;
+			attr.config = config;
+			attr.disabled = 1;
+			attr.inherit = 1;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+			return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+		}
+#endif
+
+		int m_fds[COUNTER_COUNT] = { -1, -1, -1, -1, -1 };
+		Reading m_start[COUNTER_COUNT];
+	};
+}
@@ -0,0 +1,404 @@
+// Copyright(c) 2024, Pete Brubaker <pete.brubaker@intel.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// ISPC: Making CPU SIMD fun while tracing rays!
+//
+// Graphics Programming Conference 2024
+// https://www.graphicsprogrammingconference.nl/
+//
+// Task System
+//
+// Every thread owns a deque of task ranges. A launch pushes a single range of
+// task indices; whoever pops it keeps splitting it in half, pushing the upper
+// half back, until one task is left to run. Idle threads steal from the front
+// of the other deques, so they take the largest ranges first. Threads waiting
+// in ISPCSync run tasks too, which keeps nested launches from deadlocking.
+//
+
+#include "tasksys.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	typedef void (*TaskFunc)(void* data, int threadIndex, int threadCount, int taskIndex, int taskCount,
+		int taskIndex0, int taskIndex1, int taskIndex2, int taskCount0, int taskCount1, int taskCount2);
+
+	// a single launch[] statement
+	struct Launch
+	{
+		TaskFunc func;
+		void* data;
+		int count0, count1, count2;
+	};
+
+	// everything launched or allocated against one ISPC task handle, released by ISPCSync
+	struct TaskGroup
+	{
+		std::atomic<int64_t> pending{ 0 };
+
+		std::mutex lock;
+		std::vector<std::unique_ptr<Launch>> launches;
+		std::vector<void*> allocations;
+	};
+
+	// a contiguous run of task indices [begin, end) from one launch
+	struct TaskRange
+	{
+		TaskGroup* group;
+		const Launch* launch;
+		int begin;
+		int end;
+	};
+
+	struct WorkQueue
+	{
+		std::mutex lock;
+		std::deque<TaskRange> ranges;
+	};
+
+	// queue 0 belongs to every thread outside the pool, 1..N-1 to the workers
+	thread_local int t_queueIndex = 0;
+
+	class TaskSystem
+	{
+	public:
+		explicit TaskSystem(int threadCount)
+		{
+			for (int i = 0; i < threadCount; ++i)
+			{
+				m_queues.emplace_back(std::make_unique<WorkQueue>());
+			}
+
+			for (int i = 1; i < threadCount; ++i)
+			{
+				m_workers.emplace_back([this, i] { WorkerLoop(i); });
+			}
+		}
+
+		~TaskSystem()
+		{
+			{
+				std::lock_guard<std::mutex> guard(m_sleepLock);
+				m_quit = true;
+			}
+			m_wake.notify_all();
+
+			for (std::thread& worker : m_workers)
+			{
+				worker.join();
+			}
+		}
+
+		int ThreadCount() const
+		{
+			return static_cast<int>(m_queues.size());
+		}
+
+		void Push(const TaskRange& range)
+		{
+			{
+				WorkQueue& queue = *m_queues[t_queueIndex];
+				std::lock_guard<std::mutex> guard(queue.lock);
+				queue.ranges.push_back(range);
+			}
+
+			{
+				std::lock_guard<std::mutex> guard(m_sleepLock);
+				m_queued.fetch_add(1, std::memory_order_relaxed);
+			}
+			m_wake.notify_one();
+		}
+
+		// help out until every task in the group has finished
+		void Wait(TaskGroup& group)
+		{
+			while (group.pending.load(std::memory_order_acquire) > 0)
+			{
+				if (!RunOne())
+				{
+					std::this_thread::yield();
+				}
+			}
+		}
+
+	private:
+		void WorkerLoop(int index)
+		{
+			t_queueIndex = index;
+
+			for (;;)
+			{
+				if (RunOne())
+				{
+					continue;
+				}
+
+				std::unique_lock<std::mutex> lock(m_sleepLock);
+				m_wake.wait(lock, [this] { return m_quit || m_queued.load(std::memory_order_relaxed) > 0; });
+
+				if (m_quit)
+				{
+					return;
+				}
+			}
+		}
+
+		bool RunOne()
+		{
+			TaskRange range;
+			if (!Pop(range) && !Steal(range))
+			{
+				return false;
+			}
+
+			Run(range);
+			return true;
+		}
+
+		// newest range from our own queue
+		bool Pop(TaskRange& range)
+		{
+			WorkQueue& queue = *m_queues[t_queueIndex];
+			std::lock_guard<std::mutex> guard(queue.lock);
+
+			if (queue.ranges.empty())
+			{
+				return false;
+			}
+
+			range = queue.ranges.back();
+			queue.ranges.pop_back();
+			m_queued.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+
+		// oldest range from anybody else's queue
+		bool Steal(TaskRange& range)
+		{
+			const int count = ThreadCount();
+
+			for (int i = 1; i < count; ++i)
+			{
+				WorkQueue& queue = *m_queues[(t_queueIndex + i) % count];
+				std::lock_guard<std::mutex> guard(queue.lock);
+
+				if (!queue.ranges.empty())
+				{
+					range = queue.ranges.front();
+					queue.ranges.pop_front();
+					m_queued.fetch_sub(1, std::memory_order_relaxed);
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		void Run(TaskRange range)
+		{
+			while (range.end - range.begin > 1)
+			{
+				const int middle = range.begin + (range.end - range.begin) / 2;
+				Push({ range.group, range.launch, middle, range.end });
+				range.end = middle;
+			}
+
+			const Launch& launch = *range.launch;
+			const int taskIndex = range.begin;
+			const int taskIndex0 = taskIndex % launch.count0;
+			const int taskIndex1 = (taskIndex / launch.count0) % launch.count1;
+			const int taskIndex2 = taskIndex / (launch.count0 * launch.count1);
+
+			launch.func(launch.data, t_queueIndex, ThreadCount(), taskIndex, launch.count0 * launch.count1 * launch.count2,
+				taskIndex0, taskIndex1, taskIndex2, launch.count0, launch.count1, launch.count2);
+
+			range.group->pending.fetch_sub(1, std::memory_order_release);
+		}
+
+		std::vector<std::unique_ptr<WorkQueue>> m_queues;
+		std::vector<std::thread> m_workers;
+
+		std::mutex m_sleepLock;
+		std::condition_variable m_wake;
+		std::atomic<int64_t> m_queued{ 0 };
+		bool m_quit = false;
+	};
+
+	std::mutex g_taskSystemLock;
+	std::unique_ptr<TaskSystem> g_taskSystem;
+
+	int HardwareThreadCount()
+	{
+		const unsigned int count = std::thread::hardware_concurrency();
+		return count > 0 ? static_cast<int>(count) : 1;
+	}
+
+	TaskSystem& GetTaskSystem()
+	{
+		std::lock_guard<std::mutex> guard(g_taskSystemLock);
+
+		if (!g_taskSystem)
+		{
+			g_taskSystem = std::make_unique<TaskSystem>(HardwareThreadCount());
+		}
+
+		return *g_taskSystem;
+	}
+
+	TaskGroup& GetTaskGroup(void** handlePtr)
+	{
+		if (*handlePtr == nullptr)
+		{
+			*handlePtr = new TaskGroup();
+		}
+
+		return *static_cast<TaskGroup*>(*handlePtr);
+	}
+
+	void* AlignedAlloc(size_t size, size_t alignment)
+	{
+#if defined(_WIN32)
+		return _aligned_malloc(size, alignment);
+#else
+		return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+	}
+
+	void AlignedFree(void* ptr)
+	{
+#if defined(_WIN32)
+		_aligned_free(ptr);
+#else
+		std::free(ptr);
+#endif
+	}
+}
+
+namespace TaskSys
+{
+	int GetThreadCount()
+	{
+		return GetTaskSystem().ThreadCount();
+	}
+
+	void SetThreadCount(int threadCount)
+	{
+		if (threadCount <= 0)
+		{
+			threadCount = HardwareThreadCount();
+		}
+
+		std::lock_guard<std::mutex> guard(g_taskSystemLock);
+
+		if (!g_taskSystem || g_taskSystem->ThreadCount() != threadCount)
+		{
+			g_taskSystem.reset();
+			g_taskSystem = std::make_unique<TaskSystem>(threadCount);
+		}
+	}
+}
+
+// ISPC runtime entry points, called from the code generated for launch and sync
+extern "C"
+{
+	void* ISPCAlloc(void** handlePtr, int64_t size, int32_t alignment)
+	{
+		TaskGroup& group = GetTaskGroup(handlePtr);
+
+		void* ptr = AlignedAlloc(static_cast<size_t>(size), alignment < static_cast<int32_t>(sizeof(void*)) ? sizeof(void*) : static_cast<size_t>(alignment));
+
+		std::lock_guard<std::mutex> guard(group.lock);
+		group.allocations.push_back(ptr);
+		return ptr;
+	}
+
+	void ISPCLaunch(void** handlePtr, void* f, void* data, int countx, int county, int countz)
+	{
+		TaskGroup& group = GetTaskGroup(handlePtr);
+
+		const int count = countx * county * countz;
+		if (count <= 0)
+		{
+			return;
+		}
+
+		const Launch* launch = nullptr;
+		{
+			std::lock_guard<std::mutex> guard(group.lock);
+			group.launches.emplace_back(new Launch{ reinterpret_cast<TaskFunc>(f), data, countx, county, countz });
+			launch = group.launches.back().get();
+		}
+
+		group.pending.fetch_add(count, std::memory_order_relaxed);
+		GetTaskSystem().Push({ &group, launch, 0, count });
+	}
+
+	void ISPCSync(void* handle)
+	{
+		if (handle == nullptr)
+		{
+			return;
+		}
+
+		TaskGroup* group = static_cast<TaskGroup*>(handle);
+		GetTaskSystem().Wait(*group);
+
+		for (void* ptr : group->allocations)
+		{
+			AlignedFree(ptr);
+		}
+
+		delete group;
+	}
+}
+
+namespace TaskSys
+{
+	void Launch(const int taskCount, const TaskFunction task, void* data)
+	{
+		struct Call
+		{
+			TaskFunction task;
+			void* data;
+		};
+
+		// called with the ISPC task arguments, see TaskFunc
+		const TaskFunc run = [](void* data, int, int, int taskIndex, int taskCount, int, int, int, int, int, int)
+		{
+			const Call& call = *static_cast<const Call*>(data);
+			call.task(call.data, taskIndex, taskCount);
+		};
+
+		Call call = { task, data };
+		void* handle = nullptr;
+
+		ISPCLaunch(&handle, reinterpret_cast<void*>(run), &call, taskCount, 1, 1);
+		ISPCSync(handle);
+	}
+}
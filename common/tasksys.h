@@ -0,0 +1,55 @@
+// Copyright(c) 2024, Pete Brubaker <pete.brubaker@intel.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// ISPC: Making CPU SIMD fun while tracing rays!
+//
+// Graphics Programming Conference 2024
+// https://www.graphicsprogrammingconference.nl/
+//
+// Task System
+//
+// Work-stealing thread pool behind the ISPC launch / sync runtime entry points
+// (ISPCLaunch, ISPCAlloc and ISPCSync). Link it into any target whose ISPC code
+// uses tasks.
+//
+
+#pragma once
+
+namespace TaskSys
+{
+	// number of threads running tasks, including the thread waiting in sync
+	int GetThreadCount();
+
+	// resize the pool, 0 uses every hardware thread
+	// must not be called while any launched tasks are still in flight
+	void SetThreadCount(int threadCount);
+
+	typedef void (*TaskFunction)(void* data, int taskIndex, int taskCount);
+
+	// run task(data, taskIndex, taskCount) for every taskIndex in [0, taskCount) on the pool and wait for
+	// them, the C++ side of launch[taskCount] followed by sync. Can be called from inside a task.
+	void Launch(int taskCount, TaskFunction task, void* data);
+
+	template <typename Task>
+	void Launch(const int taskCount, Task& task)
+	{
+		Launch(taskCount, [](void* data, int taskIndex, int taskCount) { (*static_cast<Task*>(data))(taskIndex, taskCount); }, &task);
+	}
+}
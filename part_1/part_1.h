@@ -31,6 +31,13 @@
 
 #include <vector>
 #include <algorithm>
+#include <cstdint>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <ranges>
+#include <span>
+#include <type_traits>
 
 #include <float.h>
 
@@ -46,6 +53,25 @@ inline void AddArrayElements(vector<float>& output, const vector<float>& a, cons
 	}
 }
 
+inline void MulArrayElements(vector<float>& output, const vector<float>& a, const vector<float>& b, const size_t count)
+{
+	#pragma loop(no_vector)
+	for (size_t i = 0; i < count; ++i)
+	{
+		output[i] = a[i] * b[i];
+	}
+}
+
+// output[i] = a[i] * s + b[i]
+inline void MulAddArrayElements(vector<float>& output, const vector<float>& a, const float s, const vector<float>& b, const size_t count)
+{
+	#pragma loop(no_vector)
+	for (size_t i = 0; i < count; ++i)
+	{
+		output[i] = a[i] * s + b[i];
+	}
+}
+
 inline void SumArray(float& sum_output, const vector<float>& a, const size_t count)
 {
 	float sum = 0.f;
@@ -103,3 +129,448 @@ inline void AverageArray(float& avg_output, const vector<float>& a, const size_t
 
 	avg_output = sum / static_cast<float>(count);
 }
+
+
+// accurate summation, see part_1.ispc
+// these need strict floating point, /fp:fast or -ffast-math will optimize the compensation away
+
+// Neumaier's variant of Kahan summation
+inline void SumArray_Kahan(float& sum_output, const vector<float>& a, const size_t count)
+{
+	float sum = 0.f;
+	float compensation = 0.f;
+
+	#pragma loop(no_vector)
+	for (size_t i = 0; i < count; ++i)
+	{
+		const float t = sum + a[i];
+
+		if (std::fabs(sum) >= std::fabs(a[i]))
+		{
+			compensation += (sum - t) + a[i];
+		}
+		else
+		{
+			compensation += (a[i] - t) + sum;
+		}
+
+		sum = t;
+	}
+
+	sum_output = sum + compensation;
+}
+
+// sums blocks of up to 128 elements serially and adds the block sums as a binary tree
+inline float SumPairwise(const float a[], const size_t count)
+{
+	if (count <= 128)
+	{
+		float sum = 0.f;
+
+		#pragma loop(no_vector)
+		for (size_t i = 0; i < count; ++i)
+		{
+			sum += a[i];
+		}
+
+		return sum;
+	}
+
+	const size_t half = count / 2;
+
+	return SumPairwise(a, half) + SumPairwise(a + half, count - half);
+}
+
+inline void SumArray_Pairwise(float& sum_output, const vector<float>& a, const size_t count)
+{
+	sum_output = SumPairwise(a.data(), count);
+}
+
+inline void AverageArray_Kahan(float& avg_output, const vector<float>& a, const size_t count)
+{
+	float sum;
+	SumArray_Kahan(sum, a, count);
+
+	avg_output = sum / static_cast<float>(count);
+}
+
+inline void AverageArray_Pairwise(float& avg_output, const vector<float>& a, const size_t count)
+{
+	avg_output = SumPairwise(a.data(), count) / static_cast<float>(count);
+}
+
+
+// all the reductions above in one pass, variance is the population variance, all zeros for an empty array
+struct ArrayStatistics
+{
+	float sum;
+	float min;
+	float max;
+	float average;
+	float variance;
+	int64_t count;
+};
+
+inline void ArrayStats(ArrayStatistics& stats, const vector<float>& a, const size_t count, const bool variance)
+{
+	if (count == 0)
+	{
+		stats = {};
+		return;
+	}
+
+	float sum = 0.f;
+	float min = FLT_MAX;
+	float max = -FLT_MAX;
+	float shifted_sum = 0.f;
+	float shifted_squares = 0.f;
+
+	const float shift = a[0];
+
+	#pragma loop(no_vector)
+	for (size_t i = 0; i < count; ++i)
+	{
+		sum += a[i];
+
+		if (a[i] < min)
+		{
+			min = a[i];
+		}
+
+		if (a[i] > max)
+		{
+			max = a[i];
+		}
+
+		if (variance)
+		{
+			const float shifted = a[i] - shift;
+			shifted_sum += shifted;
+			shifted_squares += shifted * shifted;
+		}
+	}
+
+	stats.sum = sum;
+	stats.min = min;
+	stats.max = max;
+	stats.average = sum / static_cast<float>(count);
+	stats.variance = variance ? (shifted_squares - shifted_sum * shifted_sum / static_cast<float>(count)) / static_cast<float>(count) : 0.f;
+	stats.count = static_cast<int64_t>(count);
+}
+
+// merge the statistics of the next part of an array into total, as if ArrayStats had run over both
+// works on ispc::ArrayStatistics as well, variance is only merged if both were computed with it
+template <typename Statistics>
+inline void MergeArrayStats(Statistics& total, const Statistics& part, const bool variance)
+{
+	if (part.count == 0)
+	{
+		return;
+	}
+
+	if (total.count == 0)
+	{
+		total = part;
+		return;
+	}
+
+	// Chan et al., combining the sums of squared differences from the mean of both parts
+	const double count_a = static_cast<double>(total.count);
+	const double count_b = static_cast<double>(part.count);
+	const double count = count_a + count_b;
+	const double delta = static_cast<double>(part.average) - static_cast<double>(total.average);
+	const double squares = total.variance * count_a + part.variance * count_b + delta * delta * count_a * count_b / count;
+
+	total.sum += part.sum;
+	total.min = std::min(total.min, part.min);
+	total.max = std::max(total.max, part.max);
+	total.count += part.count;
+	total.average = total.sum / static_cast<float>(total.count);
+	total.variance = variance ? static_cast<float>(squares / count) : 0.f;
+}
+
+
+// segmented reductions, segment s is values[offsets[s]] up to values[offsets[s + 1]]
+inline void SumSegments(vector<float>& output, const vector<float>& values, const vector<int64_t>& offsets, const size_t segmentCount)
+{
+	for (size_t s = 0; s < segmentCount; ++s)
+	{
+		float sum = 0.f;
+
+		#pragma loop(no_vector)
+		for (int64_t i = offsets[s]; i < offsets[s + 1]; ++i)
+		{
+			sum += values[i];
+		}
+
+		output[s] = sum;
+	}
+}
+
+inline void MinSegments(vector<float>& output, const vector<float>& values, const vector<int64_t>& offsets, const size_t segmentCount)
+{
+	for (size_t s = 0; s < segmentCount; ++s)
+	{
+		float min = FLT_MAX;
+
+		#pragma loop(no_vector)
+		for (int64_t i = offsets[s]; i < offsets[s + 1]; ++i)
+		{
+			if (values[i] < min)
+			{
+				min = values[i];
+			}
+		}
+
+		output[s] = min;
+	}
+}
+
+inline void MaxSegments(vector<float>& output, const vector<float>& values, const vector<int64_t>& offsets, const size_t segmentCount)
+{
+	for (size_t s = 0; s < segmentCount; ++s)
+	{
+		float max = -FLT_MAX;
+
+		#pragma loop(no_vector)
+		for (int64_t i = offsets[s]; i < offsets[s + 1]; ++i)
+		{
+			if (values[i] > max)
+			{
+				max = values[i];
+			}
+		}
+
+		output[s] = max;
+	}
+}
+
+
+// prefix scans, output[i] combines a[0] up to a[i], the exclusive sum stops at a[i - 1]
+inline void PrefixSum(vector<float>& output, const vector<float>& a, const size_t count)
+{
+	float sum = 0.f;
+
+	#pragma loop(no_vector)
+	for (size_t i = 0; i < count; ++i)
+	{
+		sum += a[i];
+		output[i] = sum;
+	}
+}
+
+inline void ExclusivePrefixSum(vector<float>& output, const vector<float>& a, const size_t count)
+{
+	float sum = 0.f;
+
+	#pragma loop(no_vector)
+	for (size_t i = 0; i < count; ++i)
+	{
+		output[i] = sum;
+		sum += a[i];
+	}
+}
+
+inline void PrefixMin(vector<float>& output, const vector<float>& a, const size_t count)
+{
+	float min = FLT_MAX;
+
+	#pragma loop(no_vector)
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (a[i] < min)
+		{
+			min = a[i];
+		}
+
+		output[i] = min;
+	}
+}
+
+inline void PrefixMax(vector<float>& output, const vector<float>& a, const size_t count)
+{
+	float max = -FLT_MAX;
+
+	#pragma loop(no_vector)
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (a[i] > max)
+		{
+			max = a[i];
+		}
+
+		output[i] = max;
+	}
+}
+
+
+// index of the first smallest (largest) element, NaNs are skipped, -1 if there is none
+template <typename Compare>
+inline void ArgExtreme(int64_t& index_output, const vector<float>& a, const size_t count, Compare compare)
+{
+	int64_t index = -1;
+
+	#pragma loop(no_vector)
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (!std::isnan(a[i]) && (index < 0 || compare(a[i], a[index])))
+		{
+			index = static_cast<int64_t>(i);
+		}
+	}
+
+	index_output = index;
+}
+
+inline void ArgMinArray(int64_t& index_output, const vector<float>& a, const size_t count)
+{
+	ArgExtreme(index_output, a, count, std::less<float>());
+}
+
+inline void ArgMaxArray(int64_t& index_output, const vector<float>& a, const size_t count)
+{
+	ArgExtreme(index_output, a, count, std::greater<float>());
+}
+
+// the k smallest (largest) elements in ascending (descending) order and their indices, ties go to the lower index
+// values_output and indices_output need room for k elements, only min(k, count) are written. NaNs are skipped,
+// entries they leave empty get identity and index -1.
+template <typename Compare>
+inline void TopK(vector<float>& values_output, vector<int64_t>& indices_output, const vector<float>& a, const size_t count, const size_t k, Compare compare, const float identity)
+{
+	const auto order = [&a, compare](const int64_t i, const int64_t j)
+	{
+		return compare(a[i], a[j]) || (a[i] == a[j] && i < j);
+	};
+
+	auto numbers = std::views::iota(int64_t(0), static_cast<int64_t>(count)) | std::views::filter([&a](const int64_t i) { return !std::isnan(a[i]); });
+
+	const std::span<int64_t> indices(indices_output.data(), std::min(k, count));
+	const auto last = std::ranges::partial_sort_copy(numbers, indices, order).out;
+
+	for (auto i = indices.begin(); i != indices.end(); ++i)
+	{
+		const bool found = i < last;
+		values_output[i - indices.begin()] = found ? a[*i] : identity;
+		*i = found ? *i : -1;
+	}
+}
+
+inline void TopKSmallest(vector<float>& values_output, vector<int64_t>& indices_output, const vector<float>& a, const size_t count, const size_t k)
+{
+	TopK(values_output, indices_output, a, count, k, std::less<float>(), FLT_MAX);
+}
+
+inline void TopKLargest(vector<float>& values_output, vector<int64_t>& indices_output, const vector<float>& a, const size_t count, const size_t k)
+{
+	TopK(values_output, indices_output, a, count, k, std::greater<float>(), -FLT_MAX);
+}
+
+
+// fixed width bins over [low, high), values outside are not counted
+inline void Histogram(vector<uint32_t>& output, const int binCount, const float low, const float high, const vector<float>& a, const size_t count)
+{
+	const float scale = static_cast<float>(binCount) / (high - low);
+
+	std::fill(output.begin(), output.begin() + binCount, 0);
+
+	#pragma loop(no_vector)
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (a[i] >= low && a[i] < high)
+		{
+			++output[std::min(static_cast<int>((a[i] - low) * scale), binCount - 1)];
+		}
+	}
+}
+
+// bin b is [edges[b], edges[b + 1]), edges holds binCount + 1 ascending edges
+inline void HistogramEdges(vector<uint32_t>& output, const vector<float>& edges, const int binCount, const vector<float>& a, const size_t count)
+{
+	std::fill(output.begin(), output.begin() + binCount, 0);
+
+	#pragma loop(no_vector)
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (a[i] >= edges[0] && a[i] < edges[binCount])
+		{
+			++output[std::upper_bound(edges.begin(), edges.begin() + binCount + 1, a[i]) - edges.begin() - 1];
+		}
+	}
+}
+
+
+// double precision and integer variants of the kernels at the top, the float overloads above are picked over these
+// integer sums are int64, averages are double for every type but float
+template <typename T>
+using SumType = std::conditional_t<std::is_integral_v<T>, int64_t, T>;
+
+template <typename T>
+using AverageType = std::conditional_t<std::is_same_v<T, float>, float, double>;
+
+template <typename T>
+inline void AddArrayElements(vector<T>& output, const vector<T>& a, const vector<T>& b, const size_t count)
+{
+	#pragma loop(no_vector)
+	for (size_t i = 0; i < count; ++i)
+	{
+		output[i] = a[i] + b[i];
+	}
+}
+
+template <typename T>
+inline void SumArray(SumType<T>& sum_output, const vector<T>& a, const size_t count)
+{
+	SumType<T> sum = 0;
+
+	#pragma loop(no_vector)
+	for (size_t i = 0; i < count; ++i)
+	{
+		sum += a[i];
+	}
+
+	sum_output = sum;
+}
+
+template <typename T>
+inline void MinArray(T& min_output, const vector<T>& a, const size_t count)
+{
+	T min = std::numeric_limits<T>::max();
+
+	#pragma loop(no_vector)
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (a[i] < min)
+		{
+			min = a[i];
+		}
+	}
+
+	min_output = min;
+}
+
+template <typename T>
+inline void MaxArray(T& max_output, const vector<T>& a, const size_t count)
+{
+	T max = std::numeric_limits<T>::lowest();
+
+	#pragma loop(no_vector)
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (a[i] > max)
+		{
+			max = a[i];
+		}
+	}
+
+	max_output = max;
+}
+
+template <typename T>
+inline void AverageArray(AverageType<T>& avg_output, const vector<T>& a, const size_t count)
+{
+	SumType<T> sum;
+	SumArray(sum, a, count);
+
+	avg_output = static_cast<AverageType<T>>(sum) / static_cast<AverageType<T>>(count);
+}
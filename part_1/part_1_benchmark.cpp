@@ -28,47 +28,334 @@
 //
 
 
-#define PICOBENCH_IMPLEMENT_WITH_MAIN
-#define PICOBENCH_DEFAULT_ITERATIONS {4096, 8192, 16384, 32768}
-#include "picobench/picobench.hpp"
+#include "benchmark.h"
 
-#include <vector>
+#include <cstdio>
+#include <filesystem>
+#include <map>
 #include <random>
-#include <algorithm>
+#include <string>
+#include <type_traits>
+#include <vector>
 
+#include "allocator.h"
+#include "arrayfile.h"
 #include "part_1.h"
 #include "part_1_ispc.h"
+#include "part_1_kernels.h"
+#include "tasksys.h"
 
 using std::vector;
 
+// per-target entry points, selected with --ispc-target
+ISPC_DECLARE_TARGETS(GetProgramCount);
+ISPC_DECLARE_TARGETS(AddArrayElements);
+ISPC_DECLARE_TARGETS(AddArrayElements_NonTemporal);
+ISPC_DECLARE_TARGETS(AddArrayElements_Streaming);
+ISPC_DECLARE_TARGETS(AddArrayElements_Tasks);
+ISPC_DECLARE_TARGETS(ArgMaxArray);
+ISPC_DECLARE_TARGETS(ArgMaxArray_Tasks);
+ISPC_DECLARE_TARGETS(ArgMinArray);
+ISPC_DECLARE_TARGETS(ArgMinArray_Tasks);
+ISPC_DECLARE_TARGETS(ArrayStats);
+ISPC_DECLARE_TARGETS(AverageArray);
+ISPC_DECLARE_TARGETS(AverageArray_Kahan);
+ISPC_DECLARE_TARGETS(AverageArray_Pairwise);
+ISPC_DECLARE_TARGETS(AverageArray_Tasks);
+ISPC_DECLARE_TARGETS(FillRandom_Tasks);
+ISPC_DECLARE_TARGETS(AddArrayElements_BFloat16);
+ISPC_DECLARE_TARGETS(AddArrayElements_Half);
+ISPC_DECLARE_TARGETS(AverageArray_BFloat16);
+ISPC_DECLARE_TARGETS(AverageArray_Half);
+ISPC_DECLARE_TARGETS(BFloat16ToFloatArray);
+ISPC_DECLARE_TARGETS(FloatToBFloat16Array);
+ISPC_DECLARE_TARGETS(FloatToHalfArray);
+ISPC_DECLARE_TARGETS(HalfToFloatArray);
+ISPC_DECLARE_TARGETS(Histogram);
+ISPC_DECLARE_TARGETS(Histogram_Tasks);
+ISPC_DECLARE_TARGETS(HistogramEdges);
+ISPC_DECLARE_TARGETS(HistogramEdges_Tasks);
+ISPC_DECLARE_TARGETS(MaxArray_BFloat16);
+ISPC_DECLARE_TARGETS(MaxArray_Half);
+ISPC_DECLARE_TARGETS(MinArray_BFloat16);
+ISPC_DECLARE_TARGETS(MinArray_Half);
+ISPC_DECLARE_TARGETS(SumArray_BFloat16);
+ISPC_DECLARE_TARGETS(SumArray_Half);
+ISPC_DECLARE_TARGETS(MaxSegments);
+ISPC_DECLARE_TARGETS(MinSegments);
+ISPC_DECLARE_TARGETS(MulAddArrayElements);
+ISPC_DECLARE_TARGETS(MulArrayElements);
+ISPC_DECLARE_TARGETS(SumSegments);
+ISPC_DECLARE_TARGETS(ExclusivePrefixSum);
+ISPC_DECLARE_TARGETS(ExclusivePrefixSum_Tasks);
+ISPC_DECLARE_TARGETS(PrefixMax);
+ISPC_DECLARE_TARGETS(PrefixMax_Tasks);
+ISPC_DECLARE_TARGETS(PrefixMin);
+ISPC_DECLARE_TARGETS(PrefixMin_Tasks);
+ISPC_DECLARE_TARGETS(PrefixSum);
+ISPC_DECLARE_TARGETS(PrefixSum_Tasks);
+ISPC_DECLARE_TARGETS(MaxArray);
+ISPC_DECLARE_TARGETS(MaxArray_Tasks);
+ISPC_DECLARE_TARGETS(MinArray);
+ISPC_DECLARE_TARGETS(MinArray_Tasks);
+ISPC_DECLARE_TARGETS(SumArray);
+ISPC_DECLARE_TARGETS(SumArray_Kahan);
+ISPC_DECLARE_TARGETS(SumArray_Pairwise);
+ISPC_DECLARE_TARGETS(SumArray_Tasks);
+ISPC_DECLARE_TARGETS(AddArrayElements_Double);
+ISPC_DECLARE_TARGETS(AverageArray_Double);
+ISPC_DECLARE_TARGETS(MaxArray_Double);
+ISPC_DECLARE_TARGETS(MinArray_Double);
+ISPC_DECLARE_TARGETS(SumArray_Double);
+ISPC_DECLARE_TARGETS(AddArrayElements_Int32);
+ISPC_DECLARE_TARGETS(AverageArray_Int32);
+ISPC_DECLARE_TARGETS(MaxArray_Int32);
+ISPC_DECLARE_TARGETS(MinArray_Int32);
+ISPC_DECLARE_TARGETS(SumArray_Int32);
+ISPC_DECLARE_TARGETS(AddArrayElements_Int64);
+ISPC_DECLARE_TARGETS(AverageArray_Int64);
+ISPC_DECLARE_TARGETS(MaxArray_Int64);
+ISPC_DECLARE_TARGETS(MinArray_Int64);
+ISPC_DECLARE_TARGETS(SumArray_Int64);
+ISPC_DECLARE_TARGETS(SumOfAdd);
+ISPC_DECLARE_TARGETS(SumOfMul);
+ISPC_DECLARE_TARGETS(SumOfMulAdd);
+ISPC_DECLARE_TARGETS(MinOfAdd);
+ISPC_DECLARE_TARGETS(MinOfMul);
+ISPC_DECLARE_TARGETS(MinOfMulAdd);
+ISPC_DECLARE_TARGETS(MaxOfAdd);
+ISPC_DECLARE_TARGETS(MaxOfMul);
+ISPC_DECLARE_TARGETS(MaxOfMulAdd);
+ISPC_DECLARE_TARGETS(TopKLargest);
+ISPC_DECLARE_TARGETS(TopKSmallest);
+
 // we're using static seeds so we get the same numbers every time
 static constexpr uint32_t RAND_SEED_A = 0xBAAABAAA;
 static constexpr uint32_t RAND_SEED_B = 0xB000B000;
 
 namespace
 {
+	// the fills run on every core, and the values only depend on the seed (see common/random.isph)
 	void InitializeArray(std::vector<float>& array, const size_t count)
 	{
-		std::mt19937 generator(RAND_SEED_A);
-		std::uniform_real_distribution<float> distribution(0.0f, 10.0f);
+		array.resize(count);
 
-		std::generate_n(std::back_inserter(array), count, [&] { return distribution(generator); });
+		ISPC_KERNEL(FillRandom_Tasks)(array.data(), count, RAND_SEED_A, 0.0f, 10.0f);
 	}
 
 	void InitializeDoubleArray(std::vector<float>& arrayA, std::vector<float>& arrayB, const size_t count)
 	{
-		std::mt19937 generator_a(RAND_SEED_A);
-		std::uniform_real_distribution<float> distribution_a(0.0f, 10.0f);
+		arrayA.resize(count);
+		arrayB.resize(count);
+
+		ISPC_KERNEL(FillRandom_Tasks)(arrayA.data(), count, RAND_SEED_A, 0.0f, 10.0f);
+		ISPC_KERNEL(FillRandom_Tasks)(arrayB.data(), count, RAND_SEED_B, 0.0f, 10.0f);
+	}
+
+	typedef void (*FloatTo16BitKernel)(uint16_t output[], const float input[], const int64_t count);
+
+	// 16 bit copies of InitializeArray and InitializeDoubleArray, rounded by convert
+	void Initialize16BitArray(vector<uint16_t>& array, const size_t count, FloatTo16BitKernel convert)
+	{
+		vector<float> a;
+		InitializeArray(a, count);
+
+		array.resize(count);
+		convert(array.data(), a.data(), count);
+	}
+
+	void Initialize16BitDoubleArray(vector<uint16_t>& arrayA, vector<uint16_t>& arrayB, const size_t count, FloatTo16BitKernel convert)
+	{
+		vector<float> a;
+		vector<float> b;
+		InitializeDoubleArray(a, b, count);
+
+		arrayA.resize(count);
+		arrayB.resize(count);
+		convert(arrayA.data(), a.data(), count);
+		convert(arrayB.data(), b.data(), count);
+	}
+
+	typedef void (*AddArrayElements16BitKernel)(uint16_t output[], const uint16_t a[], const uint16_t b[], const int64_t count);
+	typedef void (*Reduce16BitKernel)(float& output, const uint16_t a[], const int64_t count);
+
+	void AddArrayElements16Bit(picobench::state& s, FloatTo16BitKernel convert, AddArrayElements16BitKernel kernel)
+	{
+		vector<uint16_t> output(s.iterations());
+		vector<uint16_t> a;
+		vector<uint16_t> b;
+
+		Initialize16BitDoubleArray(a, b, s.iterations(), convert);
+
+		const int repetitions = Bench::Repetitions(s);
+
+		Bench::StartTimer(s);
+
+		#pragma loop(no_vector)
+		for (int i = 0; i < repetitions; ++i)
+		{
+			kernel(output.data(), a.data(), b.data(), s.iterations());
+
+			s.set_result((uintptr_t)&output);
+		}
+
+		Bench::StopTimer(s); // Manual stop
+	}
+
+	// returns the result, so the caller can check it
+	float Reduce16Bit(picobench::state& s, FloatTo16BitKernel convert, Reduce16BitKernel kernel)
+	{
+		float output = 0.0f;
+		vector<uint16_t> a;
+
+		Initialize16BitArray(a, s.iterations(), convert);
+
+		const int repetitions = Bench::Repetitions(s);
+
+		Bench::StartTimer(s);
+
+		#pragma loop(no_vector)
+		for (int i = 0; i < repetitions; ++i)
+		{
+			kernel(output, a.data(), s.iterations());
+
+			s.set_result((uintptr_t)&output);
+		}
+
+		Bench::StopTimer(s); // Manual stop
+
+		return output;
+	}
+
+	// long double reference for the relative error of the float sums (long double is double on MSVC)
+	long double ReferenceSum(const std::vector<float>& array, const size_t count)
+	{
+		long double sum = 0.0L;
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			sum += array[i];
+		}
+
+		return sum;
+	}
+
+	// double and integer copies of InitializeArray, integers are in [0, 1000)
+	template <typename T>
+	void InitializeTypedArray(vector<T>& array, const size_t count, const uint32_t seed)
+	{
+		vector<float> values(count);
+		ISPC_KERNEL(FillRandom_Tasks)(values.data(), count, seed, 0.0f, std::is_integral_v<T> ? 1000.0f : 10.0f);
+
+		array.assign(values.begin(), values.end());
+	}
+
+	// runs add(output, a, b, count) and checks output against the C++ reference
+	template <typename T, typename Add>
+	void AddTypedArrays(picobench::state& s, Add&& add)
+	{
+		vector<T> output(s.iterations());
+		vector<T> a;
+		vector<T> b;
+
+		InitializeTypedArray(a, s.iterations(), RAND_SEED_A);
+		InitializeTypedArray(b, s.iterations(), RAND_SEED_B);
+
+		const int repetitions = Bench::Repetitions(s);
+
+		Bench::StartTimer(s);
+
+		#pragma loop(no_vector)
+		for (int i = 0; i < repetitions; ++i)
+		{
+			add(output, a, b, s.iterations());
+
+			s.set_result((uintptr_t)&output);
+		}
+
+		Bench::StopTimer(s); // Manual stop
+
+		vector<T> expected(s.iterations());
+		AddArrayElements(expected, a, b, s.iterations());
+
+		if (output != expected)
+		{
+			fprintf(stderr, "%s: mismatch\n", Bench::CurrentBenchmark());
+		}
+	}
+
+	// runs reduce(output, a, count) and reports its relative error against reference
+	template <typename T, typename Result, typename Reduce>
+	void ReduceTyped(picobench::state& s, Reduce&& reduce, void (*reference)(Result& output, const vector<T>& a, const size_t count))
+	{
+		Result output = 0;
+		vector<T> a;
+
+		InitializeTypedArray(a, s.iterations(), RAND_SEED_A);
+
+		const int repetitions = Bench::Repetitions(s);
+
+		Bench::StartTimer(s);
+
+		#pragma loop(no_vector)
+		for (int i = 0; i < repetitions; ++i)
+		{
+			reduce(output, a, s.iterations());
+
+			s.set_result((uintptr_t)&output);
+		}
+
+		Bench::StopTimer(s); // Manual stop
+
+		Result expected = 0;
+		reference(expected, a, s.iterations());
+
+		Bench::SetError(s, static_cast<double>(output), static_cast<long double>(expected));
+	}
 
-		std::generate_n(std::back_inserter(arrayA), count, [&] { return distribution_a(generator_a); });
+	// the Typed kernels for the selected target
+	template <typename T>
+	Typed::Kernels<T> SelectedTypedKernels();
+
+#define SELECTED_TYPED_KERNELS(TYPE, SUFFIX) \
+	template <> \
+	Typed::Kernels<TYPE> SelectedTypedKernels<TYPE>() \
+	{ \
+		return \
+		{ \
+			ISPC_KERNEL(AddArrayElements##SUFFIX), ISPC_KERNEL(SumArray##SUFFIX), ISPC_KERNEL(MinArray##SUFFIX), \
+			ISPC_KERNEL(MaxArray##SUFFIX), ISPC_KERNEL(AverageArray##SUFFIX) \
+		}; \
+	}
+
+	SELECTED_TYPED_KERNELS(double, _Double)
+	SELECTED_TYPED_KERNELS(int32_t, _Int32)
+	SELECTED_TYPED_KERNELS(int64_t, _Int64)
 
-		std::mt19937 generator_b(RAND_SEED_B);
-		std::uniform_real_distribution<float> distribution_b(0.0f, 10.0f);
+#undef SELECTED_TYPED_KERNELS
+
+	// one of the Typed wrappers on the selected target, called like the C++ references
+	template <typename T>
+	auto TypedAddWith(void (*add)(vector<T>&, const vector<T>&, const vector<T>&, size_t, const Typed::Kernels<T>&))
+	{
+		return [add, kernels = SelectedTypedKernels<T>()](vector<T>& output, const vector<T>& a, const vector<T>& b, const size_t count)
+		{
+			add(output, a, b, count, kernels);
+		};
+	}
 
-		std::generate_n(std::back_inserter(arrayB), count, [&] { return distribution_b(generator_b); });
+	template <typename T, typename Result>
+	auto TypedReduceWith(void (*reduce)(Result&, const vector<T>&, size_t, const Typed::Kernels<T>&))
+	{
+		return [reduce, kernels = SelectedTypedKernels<T>()](Result& output, const vector<T>& a, const size_t count)
+		{
+			reduce(output, a, count, kernels);
+		};
 	}
 }
 
+PICOBENCH_SUITE("AddArrayElements");
+
 static void AddArrayElements_CPP(picobench::state& s)
 {
 	vector<float> output(0.0f, s.iterations());
@@ -81,17 +368,19 @@ static void AddArrayElements_CPP(picobench::state& s)
 
 	InitializeDoubleArray(a, b, s.iterations());
 
-    s.start_timer();
+	const int repetitions = Bench::Repetitions(s);
+
+    Bench::StartTimer(s);
     
 	#pragma loop(no_vector)
-    for ( int i = 0; i < s.iterations(); ++i )
+    for ( int i = 0; i < repetitions; ++i )
 	{
         AddArrayElements(output, a, b, s.iterations());
 	}
 
-    s.stop_timer(); // Manual stop
+    Bench::StopTimer(s); // Manual stop
 }
-PICOBENCH(AddArrayElements_CPP);
+PICOBENCH_THROUGHPUT(AddArrayElements_CPP, 12);
 
 static void AddArrayElements_ISPC(picobench::state& s)
 {
@@ -105,20 +394,101 @@ static void AddArrayElements_ISPC(picobench::state& s)
 
 	InitializeDoubleArray(a, b, s.iterations());
 
-	s.start_timer();
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
+
+	#pragma loop(no_vector)
+	for (int i = 0; i < repetitions; ++i)
+	{
+		ISPC_KERNEL(AddArrayElements)(output.data(), a.data(), b.data(), s.iterations());
+		s.set_result((uintptr_t)&output);
+	}
+
+	Bench::StopTimer(s); // Manual stop
+}
+PICOBENCH_THROUGHPUT(AddArrayElements_ISPC, 12);
+
+static void AddArrayElements_ISPC_Tasks(picobench::state& s)
+{
+	vector<float> output(0.0f, s.iterations());
+	vector<float> a;
+	vector<float> b;
+
+	output.resize(s.iterations());
+	a.reserve(s.iterations());
+	b.reserve(s.iterations());
+
+	InitializeDoubleArray(a, b, s.iterations());
+
+	TaskSys::SetThreadCount(static_cast<int>(s.user_data()));
+
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
 
 	#pragma loop(no_vector)
-	for (int i = 0; i < s.iterations(); ++i)
+	for (int i = 0; i < repetitions; ++i)
 	{
-		ispc::AddArrayElements(output.data(), a.data(), b.data(), s.iterations());
+		ISPC_KERNEL(AddArrayElements_Tasks)(output.data(), a.data(), b.data(), s.iterations());
 		s.set_result((uintptr_t)&output);
 	}
 
-	s.stop_timer(); // Manual stop
+	Bench::StopTimer(s); // Manual stop
+}
+PICOBENCH_THREAD_SWEEP(AddArrayElements_ISPC_Tasks, 12);
+
+static void AddArrayElements_ISPC_Half(picobench::state& s)
+{
+	AddArrayElements16Bit(s, ISPC_KERNEL(FloatToHalfArray), ISPC_KERNEL(AddArrayElements_Half));
+}
+PICOBENCH_THROUGHPUT(AddArrayElements_ISPC_Half, 6);
+
+static void AddArrayElements_ISPC_BFloat16(picobench::state& s)
+{
+	AddArrayElements16Bit(s, ISPC_KERNEL(FloatToBFloat16Array), ISPC_KERNEL(AddArrayElements_BFloat16));
+}
+PICOBENCH_THROUGHPUT(AddArrayElements_ISPC_BFloat16, 6);
+
+static void AddArrayElements_CPP_Double(picobench::state& s)
+{
+	AddTypedArrays<double>(s, AddArrayElements<double>);
+}
+PICOBENCH_THROUGHPUT(AddArrayElements_CPP_Double, 24);
+
+static void AddArrayElements_ISPC_Double(picobench::state& s)
+{
+	AddTypedArrays<double>(s, TypedAddWith(Typed::AddArrayElements<double>));
+}
+PICOBENCH_THROUGHPUT(AddArrayElements_ISPC_Double, 24);
+
+static void AddArrayElements_CPP_Int32(picobench::state& s)
+{
+	AddTypedArrays<int32_t>(s, AddArrayElements<int32_t>);
+}
+PICOBENCH_THROUGHPUT(AddArrayElements_CPP_Int32, 12);
+
+static void AddArrayElements_ISPC_Int32(picobench::state& s)
+{
+	AddTypedArrays<int32_t>(s, TypedAddWith(Typed::AddArrayElements<int32_t>));
 }
-PICOBENCH(AddArrayElements_ISPC);
+PICOBENCH_THROUGHPUT(AddArrayElements_ISPC_Int32, 12);
+
+static void AddArrayElements_CPP_Int64(picobench::state& s)
+{
+	AddTypedArrays<int64_t>(s, AddArrayElements<int64_t>);
+}
+PICOBENCH_THROUGHPUT(AddArrayElements_CPP_Int64, 24);
+
+static void AddArrayElements_ISPC_Int64(picobench::state& s)
+{
+	AddTypedArrays<int64_t>(s, TypedAddWith(Typed::AddArrayElements<int64_t>));
+}
+PICOBENCH_THROUGHPUT(AddArrayElements_ISPC_Int64, 24);
 
 
+PICOBENCH_SUITE("SumArray");
+
 static void SumArray_CPP(picobench::state& s)
 {
 	float output = 0.0f;
@@ -128,19 +498,23 @@ static void SumArray_CPP(picobench::state& s)
 
 	InitializeArray(a, s.iterations());
 
-    s.start_timer();
+	const int repetitions = Bench::Repetitions(s);
+
+    Bench::StartTimer(s);
     
 	#pragma loop(no_vector)
-    for ( int i = 0; i < s.iterations(); ++i )
+    for ( int i = 0; i < repetitions; ++i )
 	{
         SumArray(output, a, s.iterations());
 
 		s.set_result((uintptr_t)&output);
 	}
 
-    s.stop_timer(); // Manual stop
+    Bench::StopTimer(s); // Manual stop
+
+	Bench::SetError(s, output, ReferenceSum(a, s.iterations()));
 }
-PICOBENCH(SumArray_CPP);
+PICOBENCH_THROUGHPUT(SumArray_CPP, 4);
 
 static void SumArray_ISPC(picobench::state& s)
 {
@@ -151,22 +525,25 @@ static void SumArray_ISPC(picobench::state& s)
 
 	InitializeArray(a, s.iterations());
 
-	s.start_timer();
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
 
 	#pragma loop(no_vector)
-	for (int i = 0; i < s.iterations(); ++i)
+	for (int i = 0; i < repetitions; ++i)
 	{
-		ispc::SumArray(output, a.data(), s.iterations());
+		ISPC_KERNEL(SumArray)(output, a.data(), s.iterations());
 
 		s.set_result((uintptr_t)&output);
 	}
 
-	s.stop_timer(); // Manual stop
-}
-PICOBENCH(SumArray_ISPC);
+	Bench::StopTimer(s); // Manual stop
 
+	Bench::SetError(s, output, ReferenceSum(a, s.iterations()));
+}
+PICOBENCH_THROUGHPUT(SumArray_ISPC, 4);
 
-static void MinArray_CPP(picobench::state& s)
+static void SumArray_ISPC_Tasks(picobench::state& s)
 {
 	float output = 0.0f;
 	vector<float> a;
@@ -175,21 +552,27 @@ static void MinArray_CPP(picobench::state& s)
 
 	InitializeArray(a, s.iterations());
 
-	s.start_timer();
+	TaskSys::SetThreadCount(static_cast<int>(s.user_data()));
+
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
 
 	#pragma loop(no_vector)
-	for (int i = 0; i < s.iterations(); ++i)
+	for (int i = 0; i < repetitions; ++i)
 	{
-		MinArray(output, a, s.iterations());
+		ISPC_KERNEL(SumArray_Tasks)(output, a.data(), s.iterations());
 
 		s.set_result((uintptr_t)&output);
 	}
 
-	s.stop_timer(); // Manual stop
+	Bench::StopTimer(s); // Manual stop
+
+	Bench::SetError(s, output, ReferenceSum(a, s.iterations()));
 }
-PICOBENCH(MinArray_CPP);
+PICOBENCH_THREAD_SWEEP(SumArray_ISPC_Tasks, 4);
 
-static void MinArray_ISPC(picobench::state& s)
+static void SumArray_CPP_Kahan(picobench::state& s)
 {
 	float output = 0.0f;
 	vector<float> a;
@@ -198,22 +581,25 @@ static void MinArray_ISPC(picobench::state& s)
 
 	InitializeArray(a, s.iterations());
 
-	s.start_timer();
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
 
 	#pragma loop(no_vector)
-	for (int i = 0; i < s.iterations(); ++i)
+	for (int i = 0; i < repetitions; ++i)
 	{
-		ispc::MinArray(output, a.data(), s.iterations());
+		SumArray_Kahan(output, a, s.iterations());
 
 		s.set_result((uintptr_t)&output);
 	}
 
-	s.stop_timer(); // Manual stop
-}
-PICOBENCH(MinArray_ISPC);
+	Bench::StopTimer(s); // Manual stop
 
+	Bench::SetError(s, output, ReferenceSum(a, s.iterations()));
+}
+PICOBENCH_THROUGHPUT(SumArray_CPP_Kahan, 4);
 
-static void MaxArray_CPP(picobench::state& s)
+static void SumArray_CPP_Pairwise(picobench::state& s)
 {
 	float output = 0.0f;
 	vector<float> a;
@@ -222,22 +608,52 @@ static void MaxArray_CPP(picobench::state& s)
 
 	InitializeArray(a, s.iterations());
 
-	s.start_timer();
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
 
 	#pragma loop(no_vector)
-	for (int i = 0; i < s.iterations(); ++i)
+	for (int i = 0; i < repetitions; ++i)
 	{
-		MaxArray(output, a, s.iterations());
+		SumArray_Pairwise(output, a, s.iterations());
 
 		s.set_result((uintptr_t)&output);
 	}
 
-	s.stop_timer(); // Manual stop
+	Bench::StopTimer(s); // Manual stop
+
+	Bench::SetError(s, output, ReferenceSum(a, s.iterations()));
 }
-PICOBENCH(MaxArray_CPP);
+PICOBENCH_THROUGHPUT(SumArray_CPP_Pairwise, 4);
+
+static void SumArray_ISPC_Kahan(picobench::state& s)
+{
+	float output = 0.0f;
+	vector<float> a;
 
+	a.reserve(s.iterations());
 
-static void MaxArray_ISPC(picobench::state& s)
+	InitializeArray(a, s.iterations());
+
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
+
+	#pragma loop(no_vector)
+	for (int i = 0; i < repetitions; ++i)
+	{
+		ISPC_KERNEL(SumArray_Kahan)(output, a.data(), s.iterations());
+
+		s.set_result((uintptr_t)&output);
+	}
+
+	Bench::StopTimer(s); // Manual stop
+
+	Bench::SetError(s, output, ReferenceSum(a, s.iterations()));
+}
+PICOBENCH_THROUGHPUT(SumArray_ISPC_Kahan, 4);
+
+static void SumArray_ISPC_Pairwise(picobench::state& s)
 {
 	float output = 0.0f;
 	vector<float> a;
@@ -246,22 +662,88 @@ static void MaxArray_ISPC(picobench::state& s)
 
 	InitializeArray(a, s.iterations());
 
-	s.start_timer();
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
 
 	#pragma loop(no_vector)
-	for (int i = 0; i < s.iterations(); ++i)
+	for (int i = 0; i < repetitions; ++i)
 	{
-		ispc::MaxArray(output, a.data(), s.iterations());
+		ISPC_KERNEL(SumArray_Pairwise)(output, a.data(), s.iterations());
 
 		s.set_result((uintptr_t)&output);
 	}
 
-	s.stop_timer(); // Manual stop
+	Bench::StopTimer(s); // Manual stop
+
+	Bench::SetError(s, output, ReferenceSum(a, s.iterations()));
 }
-PICOBENCH(MaxArray_ISPC);
+PICOBENCH_THROUGHPUT(SumArray_ISPC_Pairwise, 4);
 
+static void SumArray_ISPC_Half(picobench::state& s)
+{
+	const float output = Reduce16Bit(s, ISPC_KERNEL(FloatToHalfArray), ISPC_KERNEL(SumArray_Half));
 
-static void AverageArray_CPP(picobench::state& s)
+	// against the float data, so this includes rounding the inputs to 16 bits
+	vector<float> a;
+	InitializeArray(a, s.iterations());
+
+	Bench::SetError(s, output, ReferenceSum(a, s.iterations()));
+}
+PICOBENCH_THROUGHPUT(SumArray_ISPC_Half, 2);
+
+static void SumArray_ISPC_BFloat16(picobench::state& s)
+{
+	const float output = Reduce16Bit(s, ISPC_KERNEL(FloatToBFloat16Array), ISPC_KERNEL(SumArray_BFloat16));
+
+	// against the float data, so this includes rounding the inputs to 16 bits
+	vector<float> a;
+	InitializeArray(a, s.iterations());
+
+	Bench::SetError(s, output, ReferenceSum(a, s.iterations()));
+}
+PICOBENCH_THROUGHPUT(SumArray_ISPC_BFloat16, 2);
+
+static void SumArray_CPP_Double(picobench::state& s)
+{
+	ReduceTyped(s, SumArray<double>, SumArray<double>);
+}
+PICOBENCH_THROUGHPUT(SumArray_CPP_Double, 8);
+
+static void SumArray_ISPC_Double(picobench::state& s)
+{
+	ReduceTyped(s, TypedReduceWith(Typed::SumArray<double>), SumArray<double>);
+}
+PICOBENCH_THROUGHPUT(SumArray_ISPC_Double, 8);
+
+static void SumArray_CPP_Int32(picobench::state& s)
+{
+	ReduceTyped(s, SumArray<int32_t>, SumArray<int32_t>);
+}
+PICOBENCH_THROUGHPUT(SumArray_CPP_Int32, 4);
+
+static void SumArray_ISPC_Int32(picobench::state& s)
+{
+	ReduceTyped(s, TypedReduceWith(Typed::SumArray<int32_t>), SumArray<int32_t>);
+}
+PICOBENCH_THROUGHPUT(SumArray_ISPC_Int32, 4);
+
+static void SumArray_CPP_Int64(picobench::state& s)
+{
+	ReduceTyped(s, SumArray<int64_t>, SumArray<int64_t>);
+}
+PICOBENCH_THROUGHPUT(SumArray_CPP_Int64, 8);
+
+static void SumArray_ISPC_Int64(picobench::state& s)
+{
+	ReduceTyped(s, TypedReduceWith(Typed::SumArray<int64_t>), SumArray<int64_t>);
+}
+PICOBENCH_THROUGHPUT(SumArray_ISPC_Int64, 8);
+
+
+PICOBENCH_SUITE("MinArray");
+
+static void MinArray_CPP(picobench::state& s)
 {
 	float output = 0.0f;
 	vector<float> a;
@@ -270,22 +752,48 @@ static void AverageArray_CPP(picobench::state& s)
 
 	InitializeArray(a, s.iterations());
 
-	s.start_timer();
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
 
 	#pragma loop(no_vector)
-	for (int i = 0; i < s.iterations(); ++i)
+	for (int i = 0; i < repetitions; ++i)
 	{
-		AverageArray(output, a, s.iterations());
+		MinArray(output, a, s.iterations());
 
 		s.set_result((uintptr_t)&output);
 	}
 
-	s.stop_timer(); // Manual stop
+	Bench::StopTimer(s); // Manual stop
 }
-PICOBENCH(AverageArray_CPP);
+PICOBENCH_THROUGHPUT(MinArray_CPP, 4);
+
+static void MinArray_ISPC(picobench::state& s)
+{
+	float output = 0.0f;
+	vector<float> a;
 
+	a.reserve(s.iterations());
 
-static void AverageArray_ISPC(picobench::state& s)
+	InitializeArray(a, s.iterations());
+
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
+
+	#pragma loop(no_vector)
+	for (int i = 0; i < repetitions; ++i)
+	{
+		ISPC_KERNEL(MinArray)(output, a.data(), s.iterations());
+
+		s.set_result((uintptr_t)&output);
+	}
+
+	Bench::StopTimer(s); // Manual stop
+}
+PICOBENCH_THROUGHPUT(MinArray_ISPC, 4);
+
+static void MinArray_ISPC_Tasks(picobench::state& s)
 {
 	float output = 0.0f;
 	vector<float> a;
@@ -294,16 +802,2221 @@ static void AverageArray_ISPC(picobench::state& s)
 
 	InitializeArray(a, s.iterations());
 
-	s.start_timer();
+	TaskSys::SetThreadCount(static_cast<int>(s.user_data()));
+
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
 
 	#pragma loop(no_vector)
-	for (int i = 0; i < s.iterations(); ++i)
+	for (int i = 0; i < repetitions; ++i)
 	{
-		ispc::AverageArray(output, a.data(), s.iterations());
+		ISPC_KERNEL(MinArray_Tasks)(output, a.data(), s.iterations());
 
 		s.set_result((uintptr_t)&output);
 	}
 
-	s.stop_timer(); // Manual stop
+	Bench::StopTimer(s); // Manual stop
+}
+PICOBENCH_THREAD_SWEEP(MinArray_ISPC_Tasks, 4);
+
+static void MinArray_ISPC_Half(picobench::state& s)
+{
+	Reduce16Bit(s, ISPC_KERNEL(FloatToHalfArray), ISPC_KERNEL(MinArray_Half));
+}
+PICOBENCH_THROUGHPUT(MinArray_ISPC_Half, 2);
+
+static void MinArray_ISPC_BFloat16(picobench::state& s)
+{
+	Reduce16Bit(s, ISPC_KERNEL(FloatToBFloat16Array), ISPC_KERNEL(MinArray_BFloat16));
+}
+PICOBENCH_THROUGHPUT(MinArray_ISPC_BFloat16, 2);
+
+static void MinArray_CPP_Double(picobench::state& s)
+{
+	ReduceTyped(s, MinArray<double>, MinArray<double>);
+}
+PICOBENCH_THROUGHPUT(MinArray_CPP_Double, 8);
+
+static void MinArray_ISPC_Double(picobench::state& s)
+{
+	ReduceTyped(s, TypedReduceWith(Typed::MinArray<double>), MinArray<double>);
+}
+PICOBENCH_THROUGHPUT(MinArray_ISPC_Double, 8);
+
+static void MinArray_CPP_Int32(picobench::state& s)
+{
+	ReduceTyped(s, MinArray<int32_t>, MinArray<int32_t>);
+}
+PICOBENCH_THROUGHPUT(MinArray_CPP_Int32, 4);
+
+static void MinArray_ISPC_Int32(picobench::state& s)
+{
+	ReduceTyped(s, TypedReduceWith(Typed::MinArray<int32_t>), MinArray<int32_t>);
+}
+PICOBENCH_THROUGHPUT(MinArray_ISPC_Int32, 4);
+
+static void MinArray_CPP_Int64(picobench::state& s)
+{
+	ReduceTyped(s, MinArray<int64_t>, MinArray<int64_t>);
+}
+PICOBENCH_THROUGHPUT(MinArray_CPP_Int64, 8);
+
+static void MinArray_ISPC_Int64(picobench::state& s)
+{
+	ReduceTyped(s, TypedReduceWith(Typed::MinArray<int64_t>), MinArray<int64_t>);
+}
+PICOBENCH_THROUGHPUT(MinArray_ISPC_Int64, 8);
+
+
+PICOBENCH_SUITE("MaxArray");
+
+static void MaxArray_CPP(picobench::state& s)
+{
+	float output = 0.0f;
+	vector<float> a;
+
+	a.reserve(s.iterations());
+
+	InitializeArray(a, s.iterations());
+
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
+
+	#pragma loop(no_vector)
+	for (int i = 0; i < repetitions; ++i)
+	{
+		MaxArray(output, a, s.iterations());
+
+		s.set_result((uintptr_t)&output);
+	}
+
+	Bench::StopTimer(s); // Manual stop
+}
+PICOBENCH_THROUGHPUT(MaxArray_CPP, 4);
+
+
+static void MaxArray_ISPC(picobench::state& s)
+{
+	float output = 0.0f;
+	vector<float> a;
+
+	a.reserve(s.iterations());
+
+	InitializeArray(a, s.iterations());
+
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
+
+	#pragma loop(no_vector)
+	for (int i = 0; i < repetitions; ++i)
+	{
+		ISPC_KERNEL(MaxArray)(output, a.data(), s.iterations());
+
+		s.set_result((uintptr_t)&output);
+	}
+
+	Bench::StopTimer(s); // Manual stop
+}
+PICOBENCH_THROUGHPUT(MaxArray_ISPC, 4);
+
+static void MaxArray_ISPC_Tasks(picobench::state& s)
+{
+	float output = 0.0f;
+	vector<float> a;
+
+	a.reserve(s.iterations());
+
+	InitializeArray(a, s.iterations());
+
+	TaskSys::SetThreadCount(static_cast<int>(s.user_data()));
+
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
+
+	#pragma loop(no_vector)
+	for (int i = 0; i < repetitions; ++i)
+	{
+		ISPC_KERNEL(MaxArray_Tasks)(output, a.data(), s.iterations());
+
+		s.set_result((uintptr_t)&output);
+	}
+
+	Bench::StopTimer(s); // Manual stop
+}
+PICOBENCH_THREAD_SWEEP(MaxArray_ISPC_Tasks, 4);
+
+static void MaxArray_ISPC_Half(picobench::state& s)
+{
+	Reduce16Bit(s, ISPC_KERNEL(FloatToHalfArray), ISPC_KERNEL(MaxArray_Half));
+}
+PICOBENCH_THROUGHPUT(MaxArray_ISPC_Half, 2);
+
+static void MaxArray_ISPC_BFloat16(picobench::state& s)
+{
+	Reduce16Bit(s, ISPC_KERNEL(FloatToBFloat16Array), ISPC_KERNEL(MaxArray_BFloat16));
+}
+PICOBENCH_THROUGHPUT(MaxArray_ISPC_BFloat16, 2);
+
+static void MaxArray_CPP_Double(picobench::state& s)
+{
+	ReduceTyped(s, MaxArray<double>, MaxArray<double>);
+}
+PICOBENCH_THROUGHPUT(MaxArray_CPP_Double, 8);
+
+static void MaxArray_ISPC_Double(picobench::state& s)
+{
+	ReduceTyped(s, TypedReduceWith(Typed::MaxArray<double>), MaxArray<double>);
+}
+PICOBENCH_THROUGHPUT(MaxArray_ISPC_Double, 8);
+
+static void MaxArray_CPP_Int32(picobench::state& s)
+{
+	ReduceTyped(s, MaxArray<int32_t>, MaxArray<int32_t>);
+}
+PICOBENCH_THROUGHPUT(MaxArray_CPP_Int32, 4);
+
+static void MaxArray_ISPC_Int32(picobench::state& s)
+{
+	ReduceTyped(s, TypedReduceWith(Typed::MaxArray<int32_t>), MaxArray<int32_t>);
+}
+PICOBENCH_THROUGHPUT(MaxArray_ISPC_Int32, 4);
+
+static void MaxArray_CPP_Int64(picobench::state& s)
+{
+	ReduceTyped(s, MaxArray<int64_t>, MaxArray<int64_t>);
+}
+PICOBENCH_THROUGHPUT(MaxArray_CPP_Int64, 8);
+
+static void MaxArray_ISPC_Int64(picobench::state& s)
+{
+	ReduceTyped(s, TypedReduceWith(Typed::MaxArray<int64_t>), MaxArray<int64_t>);
+}
+PICOBENCH_THROUGHPUT(MaxArray_ISPC_Int64, 8);
+
+
+PICOBENCH_SUITE("AverageArray");
+
+static void AverageArray_CPP(picobench::state& s)
+{
+	float output = 0.0f;
+	vector<float> a;
+
+	a.reserve(s.iterations());
+
+	InitializeArray(a, s.iterations());
+
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
+
+	#pragma loop(no_vector)
+	for (int i = 0; i < repetitions; ++i)
+	{
+		AverageArray(output, a, s.iterations());
+
+		s.set_result((uintptr_t)&output);
+	}
+
+	Bench::StopTimer(s); // Manual stop
+
+	Bench::SetError(s, output, ReferenceSum(a, s.iterations()) / s.iterations());
+}
+PICOBENCH_THROUGHPUT(AverageArray_CPP, 4);
+
+
+static void AverageArray_ISPC(picobench::state& s)
+{
+	float output = 0.0f;
+	vector<float> a;
+
+	a.reserve(s.iterations());
+
+	InitializeArray(a, s.iterations());
+
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
+
+	#pragma loop(no_vector)
+	for (int i = 0; i < repetitions; ++i)
+	{
+		ISPC_KERNEL(AverageArray)(output, a.data(), s.iterations());
+
+		s.set_result((uintptr_t)&output);
+	}
+
+	Bench::StopTimer(s); // Manual stop
+
+	Bench::SetError(s, output, ReferenceSum(a, s.iterations()) / s.iterations());
+}
+PICOBENCH_THROUGHPUT(AverageArray_ISPC, 4);
+
+static void AverageArray_ISPC_Tasks(picobench::state& s)
+{
+	float output = 0.0f;
+	vector<float> a;
+
+	a.reserve(s.iterations());
+
+	InitializeArray(a, s.iterations());
+
+	TaskSys::SetThreadCount(static_cast<int>(s.user_data()));
+
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
+
+	#pragma loop(no_vector)
+	for (int i = 0; i < repetitions; ++i)
+	{
+		ISPC_KERNEL(AverageArray_Tasks)(output, a.data(), s.iterations());
+
+		s.set_result((uintptr_t)&output);
+	}
+
+	Bench::StopTimer(s); // Manual stop
+
+	Bench::SetError(s, output, ReferenceSum(a, s.iterations()) / s.iterations());
+}
+PICOBENCH_THREAD_SWEEP(AverageArray_ISPC_Tasks, 4);
+
+static void AverageArray_CPP_Kahan(picobench::state& s)
+{
+	float output = 0.0f;
+	vector<float> a;
+
+	a.reserve(s.iterations());
+
+	InitializeArray(a, s.iterations());
+
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
+
+	#pragma loop(no_vector)
+	for (int i = 0; i < repetitions; ++i)
+	{
+		AverageArray_Kahan(output, a, s.iterations());
+
+		s.set_result((uintptr_t)&output);
+	}
+
+	Bench::StopTimer(s); // Manual stop
+
+	Bench::SetError(s, output, ReferenceSum(a, s.iterations()) / s.iterations());
+}
+PICOBENCH_THROUGHPUT(AverageArray_CPP_Kahan, 4);
+
+static void AverageArray_CPP_Pairwise(picobench::state& s)
+{
+	float output = 0.0f;
+	vector<float> a;
+
+	a.reserve(s.iterations());
+
+	InitializeArray(a, s.iterations());
+
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
+
+	#pragma loop(no_vector)
+	for (int i = 0; i < repetitions; ++i)
+	{
+		AverageArray_Pairwise(output, a, s.iterations());
+
+		s.set_result((uintptr_t)&output);
+	}
+
+	Bench::StopTimer(s); // Manual stop
+
+	Bench::SetError(s, output, ReferenceSum(a, s.iterations()) / s.iterations());
+}
+PICOBENCH_THROUGHPUT(AverageArray_CPP_Pairwise, 4);
+
+static void AverageArray_ISPC_Kahan(picobench::state& s)
+{
+	float output = 0.0f;
+	vector<float> a;
+
+	a.reserve(s.iterations());
+
+	InitializeArray(a, s.iterations());
+
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
+
+	#pragma loop(no_vector)
+	for (int i = 0; i < repetitions; ++i)
+	{
+		ISPC_KERNEL(AverageArray_Kahan)(output, a.data(), s.iterations());
+
+		s.set_result((uintptr_t)&output);
+	}
+
+	Bench::StopTimer(s); // Manual stop
+
+	Bench::SetError(s, output, ReferenceSum(a, s.iterations()) / s.iterations());
+}
+PICOBENCH_THROUGHPUT(AverageArray_ISPC_Kahan, 4);
+
+static void AverageArray_ISPC_Pairwise(picobench::state& s)
+{
+	float output = 0.0f;
+	vector<float> a;
+
+	a.reserve(s.iterations());
+
+	InitializeArray(a, s.iterations());
+
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
+
+	#pragma loop(no_vector)
+	for (int i = 0; i < repetitions; ++i)
+	{
+		ISPC_KERNEL(AverageArray_Pairwise)(output, a.data(), s.iterations());
+
+		s.set_result((uintptr_t)&output);
+	}
+
+	Bench::StopTimer(s); // Manual stop
+
+	Bench::SetError(s, output, ReferenceSum(a, s.iterations()) / s.iterations());
+}
+PICOBENCH_THROUGHPUT(AverageArray_ISPC_Pairwise, 4);
+
+static void AverageArray_ISPC_Half(picobench::state& s)
+{
+	const float output = Reduce16Bit(s, ISPC_KERNEL(FloatToHalfArray), ISPC_KERNEL(AverageArray_Half));
+
+	// against the float data, so this includes rounding the inputs to 16 bits
+	vector<float> a;
+	InitializeArray(a, s.iterations());
+
+	Bench::SetError(s, output, ReferenceSum(a, s.iterations()) / s.iterations());
+}
+PICOBENCH_THROUGHPUT(AverageArray_ISPC_Half, 2);
+
+static void AverageArray_ISPC_BFloat16(picobench::state& s)
+{
+	const float output = Reduce16Bit(s, ISPC_KERNEL(FloatToBFloat16Array), ISPC_KERNEL(AverageArray_BFloat16));
+
+	// against the float data, so this includes rounding the inputs to 16 bits
+	vector<float> a;
+	InitializeArray(a, s.iterations());
+
+	Bench::SetError(s, output, ReferenceSum(a, s.iterations()) / s.iterations());
+}
+PICOBENCH_THROUGHPUT(AverageArray_ISPC_BFloat16, 2);
+
+static void AverageArray_CPP_Double(picobench::state& s)
+{
+	ReduceTyped(s, AverageArray<double>, AverageArray<double>);
+}
+PICOBENCH_THROUGHPUT(AverageArray_CPP_Double, 8);
+
+static void AverageArray_ISPC_Double(picobench::state& s)
+{
+	ReduceTyped(s, TypedReduceWith(Typed::AverageArray<double>), AverageArray<double>);
+}
+PICOBENCH_THROUGHPUT(AverageArray_ISPC_Double, 8);
+
+static void AverageArray_CPP_Int32(picobench::state& s)
+{
+	ReduceTyped(s, AverageArray<int32_t>, AverageArray<int32_t>);
+}
+PICOBENCH_THROUGHPUT(AverageArray_CPP_Int32, 4);
+
+static void AverageArray_ISPC_Int32(picobench::state& s)
+{
+	ReduceTyped(s, TypedReduceWith(Typed::AverageArray<int32_t>), AverageArray<int32_t>);
+}
+PICOBENCH_THROUGHPUT(AverageArray_ISPC_Int32, 4);
+
+static void AverageArray_CPP_Int64(picobench::state& s)
+{
+	ReduceTyped(s, AverageArray<int64_t>, AverageArray<int64_t>);
+}
+PICOBENCH_THROUGHPUT(AverageArray_CPP_Int64, 8);
+
+static void AverageArray_ISPC_Int64(picobench::state& s)
+{
+	ReduceTyped(s, TypedReduceWith(Typed::AverageArray<int64_t>), AverageArray<int64_t>);
+}
+PICOBENCH_THROUGHPUT(AverageArray_ISPC_Int64, 8);
+
+
+// relative tolerance on sum, average and variance against LaneOrderArrayStats, which accumulates in float
+// in the same lanes as the kernels. Only the order of the final add over the lanes (reduce_add) differs,
+// a few float ulps, with room for the cancellation in the variance.
+#define ARRAY_STATS_TOLERANCE 1e-5
+
+namespace
+{
+	// sum, average and variance the way the kernels compute them, element i goes to lane i % lanes
+	ArrayStatistics LaneOrderArrayStats(const vector<float>& a, const int lanes, const bool variance)
+	{
+		ArrayStatistics stats = {};
+		if (a.empty())
+		{
+			return stats;
+		}
+
+		vector<float> sums(lanes);
+		vector<float> shiftedSums(lanes);
+		vector<float> shiftedSquares(lanes);
+
+		const float shift = a[0];
+		for (size_t i = 0; i < a.size(); ++i)
+		{
+			const size_t lane = i % lanes;
+			const float shifted = a[i] - shift;
+
+			sums[lane] += a[i];
+			shiftedSums[lane] += shifted;
+			shiftedSquares[lane] += shifted * shifted;
+		}
+
+		float shiftedSum = 0.f;
+		float shiftedSquare = 0.f;
+		for (int lane = 0; lane < lanes; ++lane)
+		{
+			stats.sum += sums[lane];
+			shiftedSum += shiftedSums[lane];
+			shiftedSquare += shiftedSquares[lane];
+		}
+
+		const float count = static_cast<float>(a.size());
+		stats.average = stats.sum / count;
+		stats.variance = variance ? (shiftedSquare - shiftedSum * shiftedSum / count) / count : 0.f;
+		stats.count = static_cast<int64_t>(a.size());
+		return stats;
+	}
+
+	// checks stats against ArrayStats for min, max and count, which have to match exactly, and against
+	// LaneOrderArrayStats for sum, average and variance. The relative error of the sum against a long
+	// double sum goes in the Error column.
+	void VerifyArrayStats(const picobench::state& s, const ispc::ArrayStatistics& stats, const vector<float>& a, const bool variance)
+	{
+		ArrayStatistics expected = {};
+		ArrayStats(expected, a, a.size(), variance);
+
+		const ArrayStatistics lanes = LaneOrderArrayStats(a, ISPC_KERNEL(GetProgramCount)(), variance);
+
+		auto near = [](const float result, const float reference)
+		{
+			return std::fabs(result - reference) <= ARRAY_STATS_TOLERANCE * std::fabs(reference);
+		};
+
+		if (stats.min != expected.min || stats.max != expected.max || stats.count != expected.count)
+		{
+			fprintf(stderr, "%s: min, max or count mismatch (%f, %f, %lld != %f, %f, %lld)\n", Bench::CurrentBenchmark(),
+				stats.min, stats.max, static_cast<long long>(stats.count), expected.min, expected.max, static_cast<long long>(expected.count));
+		}
+
+		if (!near(stats.sum, lanes.sum) || !near(stats.average, lanes.average) || !near(stats.variance, lanes.variance))
+		{
+			fprintf(stderr, "%s: sum, average or variance mismatch (%f, %f, %f != %f, %f, %f)\n", Bench::CurrentBenchmark(),
+				stats.sum, stats.average, stats.variance, lanes.sum, lanes.average, lanes.variance);
+		}
+
+		Bench::SetError(s, stats.sum, ReferenceSum(a, a.size()));
+	}
+
+	// the fused kernel on an empty array, which gives all zeros
+	void VerifyEmptyArrayStats(const bool variance)
+	{
+		ispc::ArrayStatistics stats = { 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1 };
+
+		const float a[1] = {};
+		ISPC_KERNEL(ArrayStats)(stats, a, 0, variance);
+
+		if (stats.sum != 0 || stats.min != 0 || stats.max != 0 || stats.average != 0 || stats.variance != 0 || stats.count != 0)
+		{
+			fprintf(stderr, "%s: empty array doesn't give zeros\n", Bench::CurrentBenchmark());
+		}
+	}
+}
+
+PICOBENCH_SUITE("ArrayStats");
+
+static void ArrayStats_Separate_ISPC(picobench::state& s)
+{
+	float sum = 0.0f;
+	float min = 0.0f;
+	float max = 0.0f;
+	float average = 0.0f;
+	vector<float> a;
+
+	a.reserve(s.iterations());
+
+	InitializeArray(a, s.iterations());
+
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
+
+	#pragma loop(no_vector)
+	for (int i = 0; i < repetitions; ++i)
+	{
+		ISPC_KERNEL(SumArray)(sum, a.data(), s.iterations());
+		ISPC_KERNEL(MinArray)(min, a.data(), s.iterations());
+		ISPC_KERNEL(MaxArray)(max, a.data(), s.iterations());
+		ISPC_KERNEL(AverageArray)(average, a.data(), s.iterations());
+	}
+
+	Bench::StopTimer(s); // Manual stop
+
+	s.set_result((uintptr_t)(sum + min + max + average));
+
+	const ispc::ArrayStatistics stats = { sum, min, max, average, 0.0f, static_cast<int64_t>(a.size()) };
+	VerifyArrayStats(s, stats, a, false);
+}
+PICOBENCH_THROUGHPUT(ArrayStats_Separate_ISPC, 4);
+
+static void ArrayStats_ISPC(picobench::state& s)
+{
+	ispc::ArrayStatistics stats = {};
+	vector<float> a;
+
+	a.reserve(s.iterations());
+
+	InitializeArray(a, s.iterations());
+
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
+
+	#pragma loop(no_vector)
+	for (int i = 0; i < repetitions; ++i)
+	{
+		ISPC_KERNEL(ArrayStats)(stats, a.data(), s.iterations(), false);
+	}
+
+	Bench::StopTimer(s); // Manual stop
+
+	s.set_result((uintptr_t)(stats.sum + stats.min + stats.max + stats.average));
+
+	VerifyArrayStats(s, stats, a, false);
+	VerifyEmptyArrayStats(false);
+}
+PICOBENCH_THROUGHPUT(ArrayStats_ISPC, 4);
+
+static void ArrayStats_ISPC_Variance(picobench::state& s)
+{
+	ispc::ArrayStatistics stats = {};
+	vector<float> a;
+
+	a.reserve(s.iterations());
+
+	InitializeArray(a, s.iterations());
+
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
+
+	#pragma loop(no_vector)
+	for (int i = 0; i < repetitions; ++i)
+	{
+		ISPC_KERNEL(ArrayStats)(stats, a.data(), s.iterations(), true);
+	}
+
+	Bench::StopTimer(s); // Manual stop
+
+	s.set_result((uintptr_t)(stats.sum + stats.min + stats.max + stats.average));
+
+	VerifyArrayStats(s, stats, a, true);
+	VerifyEmptyArrayStats(true);
+}
+PICOBENCH_THROUGHPUT(ArrayStats_ISPC_Variance, 4);
+
+static void ArrayStats_CPP(picobench::state& s)
+{
+	ArrayStatistics stats = {};
+	vector<float> a;
+
+	a.reserve(s.iterations());
+
+	InitializeArray(a, s.iterations());
+
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
+
+	#pragma loop(no_vector)
+	for (int i = 0; i < repetitions; ++i)
+	{
+		ArrayStats(stats, a, s.iterations(), false);
+	}
+
+	Bench::StopTimer(s); // Manual stop
+
+	s.set_result((uintptr_t)(stats.sum + stats.min + stats.max + stats.average));
+}
+PICOBENCH_THROUGHPUT(ArrayStats_CPP, 4);
+
+
+// SumArray, MinArray and MaxArray over segments of 10 to 500 elements, packed into one array of Dim
+// elements. _ISPC_PerArray calls the per array kernel once per segment, _ISPC reduces them all in one call.
+// SumSegments_Short uses segments of 4 to 16 elements, where the ISPC kernel gives every lane its own segment.
+#define SEGMENT_LENGTHS 10, 500
+#define SHORT_SEGMENT_LENGTHS 4, 16
+
+namespace
+{
+	struct Segments
+	{
+		vector<float> values;
+		vector<int64_t> offsets;
+
+		size_t Count() const { return offsets.size() - 1; }
+	};
+
+	void InitializeSegments(Segments& segments, const size_t count, const int64_t minLength, const int64_t maxLength)
+	{
+		std::mt19937 generator(RAND_SEED_B);
+		std::uniform_int_distribution<int64_t> length(minLength, maxLength);
+
+		InitializeArray(segments.values, count);
+
+		// the last segment is cut short to end at count
+		segments.offsets.assign(1, 0);
+		while (segments.offsets.back() < static_cast<int64_t>(count))
+		{
+			segments.offsets.push_back(std::min<int64_t>(segments.offsets.back() + length(generator), count));
+		}
+	}
+
+	typedef void (*SegmentsReference)(vector<float>& output, const vector<float>& values, const vector<int64_t>& offsets, const size_t segmentCount);
+
+	// runs reduce(output, segments) and checks output against reference
+	template <typename Reduce>
+	void ReduceSegments(picobench::state& s, Reduce&& reduce, SegmentsReference reference, const int64_t minLength, const int64_t maxLength)
+	{
+		Segments segments;
+		InitializeSegments(segments, s.iterations(), minLength, maxLength);
+
+		vector<float> output(segments.Count());
+
+		const int repetitions = Bench::Repetitions(s);
+
+		Bench::StartTimer(s);
+
+		#pragma loop(no_vector)
+		for (int i = 0; i < repetitions; ++i)
+		{
+			reduce(output, segments);
+
+			s.set_result((uintptr_t)&output);
+		}
+
+		Bench::StopTimer(s); // Manual stop
+
+		vector<float> expected(segments.Count());
+		reference(expected, segments.values, segments.offsets, segments.Count());
+
+		for (size_t i = 0; i < segments.Count(); ++i)
+		{
+			if (std::fabs(output[i] - expected[i]) > 1e-5f * std::max(1.f, std::fabs(expected[i])))
+			{
+				fprintf(stderr, "%s: mismatch in segment %zu (%f != %f)\n", Bench::CurrentBenchmark(), i, output[i], expected[i]);
+				break;
+			}
+		}
+	}
+
+	typedef void (*ArrayReductionKernel)(float& output, const float a[], const int64_t count);
+
+	void ReducePerArray(vector<float>& output, const Segments& segments, ArrayReductionKernel kernel)
+	{
+		for (size_t i = 0; i < segments.Count(); ++i)
+		{
+			kernel(output[i], &segments.values[segments.offsets[i]], segments.offsets[i + 1] - segments.offsets[i]);
+		}
+	}
+}
+
+PICOBENCH_SUITE("SumSegments");
+
+static void SumSegments_CPP(picobench::state& s)
+{
+	ReduceSegments(s, [](vector<float>& output, const Segments& segments)
+	{
+		SumSegments(output, segments.values, segments.offsets, segments.Count());
+	}, SumSegments, SEGMENT_LENGTHS);
+}
+PICOBENCH_THROUGHPUT(SumSegments_CPP, 4);
+
+static void SumSegments_ISPC_PerArray(picobench::state& s)
+{
+	const auto kernel = ISPC_KERNEL(SumArray);
+
+	ReduceSegments(s, [kernel](vector<float>& output, const Segments& segments)
+	{
+		ReducePerArray(output, segments, kernel);
+	}, SumSegments, SEGMENT_LENGTHS);
+}
+PICOBENCH_THROUGHPUT(SumSegments_ISPC_PerArray, 4);
+
+static void SumSegments_ISPC(picobench::state& s)
+{
+	const auto kernel = ISPC_KERNEL(SumSegments);
+
+	ReduceSegments(s, [kernel](vector<float>& output, const Segments& segments)
+	{
+		kernel(output.data(), segments.values.data(), segments.offsets.data(), segments.Count());
+	}, SumSegments, SEGMENT_LENGTHS);
+}
+PICOBENCH_THROUGHPUT(SumSegments_ISPC, 4);
+
+
+PICOBENCH_SUITE("MinSegments");
+
+static void MinSegments_CPP(picobench::state& s)
+{
+	ReduceSegments(s, [](vector<float>& output, const Segments& segments)
+	{
+		MinSegments(output, segments.values, segments.offsets, segments.Count());
+	}, MinSegments, SEGMENT_LENGTHS);
+}
+PICOBENCH_THROUGHPUT(MinSegments_CPP, 4);
+
+static void MinSegments_ISPC_PerArray(picobench::state& s)
+{
+	const auto kernel = ISPC_KERNEL(MinArray);
+
+	ReduceSegments(s, [kernel](vector<float>& output, const Segments& segments)
+	{
+		ReducePerArray(output, segments, kernel);
+	}, MinSegments, SEGMENT_LENGTHS);
+}
+PICOBENCH_THROUGHPUT(MinSegments_ISPC_PerArray, 4);
+
+static void MinSegments_ISPC(picobench::state& s)
+{
+	const auto kernel = ISPC_KERNEL(MinSegments);
+
+	ReduceSegments(s, [kernel](vector<float>& output, const Segments& segments)
+	{
+		kernel(output.data(), segments.values.data(), segments.offsets.data(), segments.Count());
+	}, MinSegments, SEGMENT_LENGTHS);
+}
+PICOBENCH_THROUGHPUT(MinSegments_ISPC, 4);
+
+
+PICOBENCH_SUITE("MaxSegments");
+
+static void MaxSegments_CPP(picobench::state& s)
+{
+	ReduceSegments(s, [](vector<float>& output, const Segments& segments)
+	{
+		MaxSegments(output, segments.values, segments.offsets, segments.Count());
+	}, MaxSegments, SEGMENT_LENGTHS);
+}
+PICOBENCH_THROUGHPUT(MaxSegments_CPP, 4);
+
+static void MaxSegments_ISPC_PerArray(picobench::state& s)
+{
+	const auto kernel = ISPC_KERNEL(MaxArray);
+
+	ReduceSegments(s, [kernel](vector<float>& output, const Segments& segments)
+	{
+		ReducePerArray(output, segments, kernel);
+	}, MaxSegments, SEGMENT_LENGTHS);
+}
+PICOBENCH_THROUGHPUT(MaxSegments_ISPC_PerArray, 4);
+
+static void MaxSegments_ISPC(picobench::state& s)
+{
+	const auto kernel = ISPC_KERNEL(MaxSegments);
+
+	ReduceSegments(s, [kernel](vector<float>& output, const Segments& segments)
+	{
+		kernel(output.data(), segments.values.data(), segments.offsets.data(), segments.Count());
+	}, MaxSegments, SEGMENT_LENGTHS);
+}
+PICOBENCH_THROUGHPUT(MaxSegments_ISPC, 4);
+
+
+PICOBENCH_SUITE("SumSegments_Short");
+
+static void SumSegments_Short_CPP(picobench::state& s)
+{
+	ReduceSegments(s, [](vector<float>& output, const Segments& segments)
+	{
+		SumSegments(output, segments.values, segments.offsets, segments.Count());
+	}, SumSegments, SHORT_SEGMENT_LENGTHS);
+}
+PICOBENCH_THROUGHPUT(SumSegments_Short_CPP, 4);
+
+static void SumSegments_Short_ISPC_PerArray(picobench::state& s)
+{
+	const auto kernel = ISPC_KERNEL(SumArray);
+
+	ReduceSegments(s, [kernel](vector<float>& output, const Segments& segments)
+	{
+		ReducePerArray(output, segments, kernel);
+	}, SumSegments, SHORT_SEGMENT_LENGTHS);
+}
+PICOBENCH_THROUGHPUT(SumSegments_Short_ISPC_PerArray, 4);
+
+static void SumSegments_Short_ISPC(picobench::state& s)
+{
+	const auto kernel = ISPC_KERNEL(SumSegments);
+
+	ReduceSegments(s, [kernel](vector<float>& output, const Segments& segments)
+	{
+		kernel(output.data(), segments.values.data(), segments.offsets.data(), segments.Count());
+	}, SumSegments, SHORT_SEGMENT_LENGTHS);
+}
+PICOBENCH_THROUGHPUT(SumSegments_Short_ISPC, 4);
+
+
+// Inclusive and exclusive prefix sums, prefix min and prefix max of Dim elements. Min and max have to
+// match the serial C++ scans exactly. The sums are added in a different order by every variant, so they
+// report the largest relative error of any element against a long double running sum instead.
+namespace
+{
+	// runs scan(output, a) over a random array of Dim elements
+	template <typename Scan>
+	void TimeScan(picobench::state& s, Scan&& scan, vector<float>& output, vector<float>& a)
+	{
+		output.resize(s.iterations());
+		InitializeArray(a, s.iterations());
+
+		const int repetitions = Bench::Repetitions(s);
+
+		Bench::StartTimer(s);
+
+		#pragma loop(no_vector)
+		for (int i = 0; i < repetitions; ++i)
+		{
+			scan(output, a);
+
+			s.set_result((uintptr_t)&output);
+		}
+
+		Bench::StopTimer(s); // Manual stop
+	}
+
+	template <typename Scan>
+	void SumScan(picobench::state& s, Scan&& scan, const bool exclusive)
+	{
+		vector<float> output;
+		vector<float> a;
+		TimeScan(s, scan, output, a);
+
+		long double sum = 0.0L;
+		double worstResult = 0.0;
+		long double worstReference = 0.0L;
+		long double worstError = -1.0L;
+
+		for (size_t i = 0; i < a.size(); ++i)
+		{
+			const long double inclusive = sum + a[i];
+			const long double reference = exclusive ? sum : inclusive;
+			sum = inclusive;
+
+			const long double error = std::fabs(output[i] - reference) / std::max(reference, 1.0L);
+			if (error > worstError)
+			{
+				worstError = error;
+				worstResult = output[i];
+				worstReference = reference;
+			}
+		}
+
+		Bench::SetError(s, worstResult, worstReference);
+	}
+
+	typedef void (*ScanReference)(vector<float>& output, const vector<float>& a, const size_t count);
+
+	template <typename Scan>
+	void ExactScan(picobench::state& s, Scan&& scan, ScanReference reference)
+	{
+		vector<float> output;
+		vector<float> a;
+		TimeScan(s, scan, output, a);
+
+		vector<float> expected(a.size());
+		reference(expected, a, a.size());
+
+		for (size_t i = 0; i < a.size(); ++i)
+		{
+			if (output[i] != expected[i])
+			{
+				fprintf(stderr, "%s: mismatch at %zu (%f != %f)\n", Bench::CurrentBenchmark(), i, output[i], expected[i]);
+				break;
+			}
+		}
+	}
+
+	typedef void (*ScanKernel)(float output[], const float a[], const int64_t count);
+
+	// the ISPC kernels as a scan for TimeScan
+	auto ScanWith(ScanKernel kernel)
+	{
+		return [kernel](vector<float>& output, const vector<float>& a)
+		{
+			kernel(output.data(), a.data(), a.size());
+		};
+	}
+}
+
+PICOBENCH_SUITE("PrefixSum");
+
+static void PrefixSum_CPP(picobench::state& s)
+{
+	SumScan(s, [](vector<float>& output, const vector<float>& a)
+	{
+		PrefixSum(output, a, a.size());
+	}, false);
+}
+PICOBENCH_THROUGHPUT(PrefixSum_CPP, 8);
+
+static void PrefixSum_ISPC(picobench::state& s)
+{
+	SumScan(s, ScanWith(ISPC_KERNEL(PrefixSum)), false);
+}
+PICOBENCH_THROUGHPUT(PrefixSum_ISPC, 8);
+
+static void PrefixSum_ISPC_Tasks(picobench::state& s)
+{
+	TaskSys::SetThreadCount(static_cast<int>(s.user_data()));
+
+	SumScan(s, ScanWith(ISPC_KERNEL(PrefixSum_Tasks)), false);
+}
+PICOBENCH_THREAD_SWEEP(PrefixSum_ISPC_Tasks, 8);
+
+static void ExclusivePrefixSum_CPP(picobench::state& s)
+{
+	SumScan(s, [](vector<float>& output, const vector<float>& a)
+	{
+		ExclusivePrefixSum(output, a, a.size());
+	}, true);
+}
+PICOBENCH_THROUGHPUT(ExclusivePrefixSum_CPP, 8);
+
+static void ExclusivePrefixSum_ISPC(picobench::state& s)
+{
+	SumScan(s, ScanWith(ISPC_KERNEL(ExclusivePrefixSum)), true);
+}
+PICOBENCH_THROUGHPUT(ExclusivePrefixSum_ISPC, 8);
+
+static void ExclusivePrefixSum_ISPC_Tasks(picobench::state& s)
+{
+	TaskSys::SetThreadCount(static_cast<int>(s.user_data()));
+
+	SumScan(s, ScanWith(ISPC_KERNEL(ExclusivePrefixSum_Tasks)), true);
+}
+PICOBENCH_THREAD_SWEEP(ExclusivePrefixSum_ISPC_Tasks, 8);
+
+
+PICOBENCH_SUITE("PrefixMin");
+
+static void PrefixMin_CPP(picobench::state& s)
+{
+	ExactScan(s, [](vector<float>& output, const vector<float>& a)
+	{
+		PrefixMin(output, a, a.size());
+	}, PrefixMin);
+}
+PICOBENCH_THROUGHPUT(PrefixMin_CPP, 8);
+
+static void PrefixMin_ISPC(picobench::state& s)
+{
+	ExactScan(s, ScanWith(ISPC_KERNEL(PrefixMin)), PrefixMin);
+}
+PICOBENCH_THROUGHPUT(PrefixMin_ISPC, 8);
+
+static void PrefixMin_ISPC_Tasks(picobench::state& s)
+{
+	TaskSys::SetThreadCount(static_cast<int>(s.user_data()));
+
+	ExactScan(s, ScanWith(ISPC_KERNEL(PrefixMin_Tasks)), PrefixMin);
+}
+PICOBENCH_THREAD_SWEEP(PrefixMin_ISPC_Tasks, 8);
+
+
+PICOBENCH_SUITE("PrefixMax");
+
+static void PrefixMax_CPP(picobench::state& s)
+{
+	ExactScan(s, [](vector<float>& output, const vector<float>& a)
+	{
+		PrefixMax(output, a, a.size());
+	}, PrefixMax);
+}
+PICOBENCH_THROUGHPUT(PrefixMax_CPP, 8);
+
+static void PrefixMax_ISPC(picobench::state& s)
+{
+	ExactScan(s, ScanWith(ISPC_KERNEL(PrefixMax)), PrefixMax);
+}
+PICOBENCH_THROUGHPUT(PrefixMax_ISPC, 8);
+
+static void PrefixMax_ISPC_Tasks(picobench::state& s)
+{
+	TaskSys::SetThreadCount(static_cast<int>(s.user_data()));
+
+	ExactScan(s, ScanWith(ISPC_KERNEL(PrefixMax_Tasks)), PrefixMax);
+}
+PICOBENCH_THREAD_SWEEP(PrefixMax_ISPC_Tasks, 8);
+
+
+// ArgMin and ArgMax check the index against std::min_element / std::max_element, TopK checks the values
+// and indices against std::ranges::partial_sort_copy (see part_1.h), for k = 8 and k = 64. Both are
+// checked once more on an input that is mostly NaN, which they skip.
+namespace
+{
+	// the first elements of a with all but every 8th one NaN, the first one included
+	vector<float> MostlyNaN(const vector<float>& a, const size_t count)
+	{
+		vector<float> output(a.begin(), a.begin() + std::min(count, a.size()));
+		for (size_t i = 0; i < output.size(); ++i)
+		{
+			output[i] = i % 8 == 7 ? output[i] : NAN;
+		}
+
+		return output;
+	}
+
+	typedef void (*ArgReductionReference)(int64_t& index_output, const vector<float>& a, const size_t count);
+
+	template <typename Reduce>
+	void ArgReduction(picobench::state& s, Reduce&& reduce, ArgReductionReference reference)
+	{
+		int64_t output = -1;
+		vector<float> a;
+
+		InitializeArray(a, s.iterations());
+
+		const int repetitions = Bench::Repetitions(s);
+
+		Bench::StartTimer(s);
+
+		#pragma loop(no_vector)
+		for (int i = 0; i < repetitions; ++i)
+		{
+			reduce(output, a);
+
+			s.set_result((uintptr_t)output);
+		}
+
+		Bench::StopTimer(s); // Manual stop
+
+		int64_t expected = -1;
+		reference(expected, a, a.size());
+
+		if (output != expected)
+		{
+			fprintf(stderr, "%s: index %lld != %lld\n", Bench::CurrentBenchmark(), (long long)output, (long long)expected);
+		}
+
+		const vector<float> nans = MostlyNaN(a, 1000);
+		reduce(output, nans);
+		reference(expected, nans, nans.size());
+
+		if (output != expected)
+		{
+			fprintf(stderr, "%s: index %lld != %lld with NaNs\n", Bench::CurrentBenchmark(), (long long)output, (long long)expected);
+		}
+	}
+
+	typedef void (*ArgReductionKernel)(int64_t& index_output, const float a[], const int64_t count);
+
+	auto ArgReductionWith(ArgReductionKernel kernel)
+	{
+		return [kernel](int64_t& output, const vector<float>& a)
+		{
+			kernel(output, a.data(), a.size());
+		};
+	}
+
+	typedef void (*TopKReference)(vector<float>& values_output, vector<int64_t>& indices_output, const vector<float>& a, const size_t count, const size_t k);
+
+	// runs select(values, indices, a, count, k) and checks the result against reference
+	template <typename Select>
+	void SelectTopK(picobench::state& s, Select&& select, TopKReference reference, const size_t k)
+	{
+		vector<float> values(k);
+		vector<int64_t> indices(k);
+		vector<float> a;
+
+		InitializeArray(a, s.iterations());
+
+		const int repetitions = Bench::Repetitions(s);
+
+		Bench::StartTimer(s);
+
+		#pragma loop(no_vector)
+		for (int i = 0; i < repetitions; ++i)
+		{
+			select(values, indices, a, a.size(), k);
+
+			s.set_result((uintptr_t)&values);
+		}
+
+		Bench::StopTimer(s); // Manual stop
+
+		vector<float> expectedValues(k);
+		vector<int64_t> expectedIndices(k);
+		reference(expectedValues, expectedIndices, a, a.size(), k);
+
+		if (values != expectedValues || indices != expectedIndices)
+		{
+			fprintf(stderr, "%s: top %zu mismatch\n", Bench::CurrentBenchmark(), k);
+		}
+
+		// fewer than k numbers, so the NaNs leave entries empty
+		const vector<float> nans = MostlyNaN(a, 4 * k);
+		select(values, indices, nans, nans.size(), k);
+		reference(expectedValues, expectedIndices, nans, nans.size(), k);
+
+		if (values != expectedValues || indices != expectedIndices)
+		{
+			fprintf(stderr, "%s: top %zu mismatch with NaNs\n", Bench::CurrentBenchmark(), k);
+		}
+	}
+
+	typedef void (*TopKKernel)(float values_output[], int64_t indices_output[], const float a[], const int64_t count, const int64_t k);
+
+	auto TopKWith(TopKKernel kernel)
+	{
+		return [kernel](vector<float>& values, vector<int64_t>& indices, const vector<float>& a, const size_t count, const size_t k)
+		{
+			kernel(values.data(), indices.data(), a.data(), count, k);
+		};
+	}
+}
+
+PICOBENCH_SUITE("ArgMin");
+
+static void ArgMinArray_CPP(picobench::state& s)
+{
+	ArgReduction(s, [](int64_t& output, const vector<float>& a)
+	{
+		ArgMinArray(output, a, a.size());
+	}, ArgMinArray);
+}
+PICOBENCH_THROUGHPUT(ArgMinArray_CPP, 4);
+
+static void ArgMinArray_ISPC(picobench::state& s)
+{
+	ArgReduction(s, ArgReductionWith(ISPC_KERNEL(ArgMinArray)), ArgMinArray);
+}
+PICOBENCH_THROUGHPUT(ArgMinArray_ISPC, 4);
+
+static void ArgMinArray_ISPC_Tasks(picobench::state& s)
+{
+	TaskSys::SetThreadCount(static_cast<int>(s.user_data()));
+
+	ArgReduction(s, ArgReductionWith(ISPC_KERNEL(ArgMinArray_Tasks)), ArgMinArray);
+}
+PICOBENCH_THREAD_SWEEP(ArgMinArray_ISPC_Tasks, 4);
+
+
+PICOBENCH_SUITE("ArgMax");
+
+static void ArgMaxArray_CPP(picobench::state& s)
+{
+	ArgReduction(s, [](int64_t& output, const vector<float>& a)
+	{
+		ArgMaxArray(output, a, a.size());
+	}, ArgMaxArray);
+}
+PICOBENCH_THROUGHPUT(ArgMaxArray_CPP, 4);
+
+static void ArgMaxArray_ISPC(picobench::state& s)
+{
+	ArgReduction(s, ArgReductionWith(ISPC_KERNEL(ArgMaxArray)), ArgMaxArray);
+}
+PICOBENCH_THROUGHPUT(ArgMaxArray_ISPC, 4);
+
+static void ArgMaxArray_ISPC_Tasks(picobench::state& s)
+{
+	TaskSys::SetThreadCount(static_cast<int>(s.user_data()));
+
+	ArgReduction(s, ArgReductionWith(ISPC_KERNEL(ArgMaxArray_Tasks)), ArgMaxArray);
+}
+PICOBENCH_THREAD_SWEEP(ArgMaxArray_ISPC_Tasks, 4);
+
+
+PICOBENCH_SUITE("TopK");
+
+static void TopKSmallest_K8_CPP(picobench::state& s)
+{
+	SelectTopK(s, TopKSmallest, TopKSmallest, 8);
+}
+PICOBENCH_THROUGHPUT(TopKSmallest_K8_CPP, 4);
+
+static void TopKSmallest_K8_ISPC(picobench::state& s)
+{
+	SelectTopK(s, TopKWith(ISPC_KERNEL(TopKSmallest)), TopKSmallest, 8);
+}
+PICOBENCH_THROUGHPUT(TopKSmallest_K8_ISPC, 4);
+
+static void TopKSmallest_K64_CPP(picobench::state& s)
+{
+	SelectTopK(s, TopKSmallest, TopKSmallest, 64);
+}
+PICOBENCH_THROUGHPUT(TopKSmallest_K64_CPP, 4);
+
+static void TopKSmallest_K64_ISPC(picobench::state& s)
+{
+	SelectTopK(s, TopKWith(ISPC_KERNEL(TopKSmallest)), TopKSmallest, 64);
+}
+PICOBENCH_THROUGHPUT(TopKSmallest_K64_ISPC, 4);
+
+static void TopKLargest_K8_CPP(picobench::state& s)
+{
+	SelectTopK(s, TopKLargest, TopKLargest, 8);
+}
+PICOBENCH_THROUGHPUT(TopKLargest_K8_CPP, 4);
+
+static void TopKLargest_K8_ISPC(picobench::state& s)
+{
+	SelectTopK(s, TopKWith(ISPC_KERNEL(TopKLargest)), TopKLargest, 8);
+}
+PICOBENCH_THROUGHPUT(TopKLargest_K8_ISPC, 4);
+
+static void TopKLargest_K64_CPP(picobench::state& s)
+{
+	SelectTopK(s, TopKLargest, TopKLargest, 64);
+}
+PICOBENCH_THROUGHPUT(TopKLargest_K64_CPP, 4);
+
+static void TopKLargest_K64_ISPC(picobench::state& s)
+{
+	SelectTopK(s, TopKWith(ISPC_KERNEL(TopKLargest)), TopKLargest, 64);
+}
+PICOBENCH_THROUGHPUT(TopKLargest_K64_ISPC, 4);
+
+
+// Histogram counts Dim values in [0, 10) into 16, 256 or 4096 bins of equal width, HistogramEdges into
+// bins that get wider from 0 to 10, so the kernels have to search the edges. Every variant has to match
+// the scalar C++ loops in part_1.h exactly.
+#define HISTOGRAM_LOW 0.0f
+#define HISTOGRAM_HIGH 10.0f
+
+namespace
+{
+	vector<float> HistogramEdgesFor(const int binCount)
+	{
+		vector<float> edges(binCount + 1);
+
+		for (int i = 0; i <= binCount; ++i)
+		{
+			const float t = static_cast<float>(i) / binCount;
+			edges[i] = HISTOGRAM_LOW + (HISTOGRAM_HIGH - HISTOGRAM_LOW) * t * t;
+		}
+
+		return edges;
+	}
+
+	// runs count(output, edges, a) over Dim values, and checks output against the fixed width or explicit edge reference
+	template <typename Count>
+	void CountHistogram(picobench::state& s, Count&& count, const int binCount, const bool explicitEdges)
+	{
+		vector<uint32_t> output(binCount);
+		const vector<float> edges = HistogramEdgesFor(binCount);
+		vector<float> a;
+
+		InitializeArray(a, s.iterations());
+
+		const int repetitions = Bench::Repetitions(s);
+
+		Bench::StartTimer(s);
+
+		#pragma loop(no_vector)
+		for (int i = 0; i < repetitions; ++i)
+		{
+			count(output, edges, a);
+
+			s.set_result((uintptr_t)&output);
+		}
+
+		Bench::StopTimer(s); // Manual stop
+
+		vector<uint32_t> expected(binCount);
+		if (explicitEdges)
+		{
+			HistogramEdges(expected, edges, binCount, a, a.size());
+		}
+		else
+		{
+			Histogram(expected, binCount, HISTOGRAM_LOW, HISTOGRAM_HIGH, a, a.size());
+		}
+
+		if (output != expected)
+		{
+			fprintf(stderr, "%s: histogram of %d bins mismatch\n", Bench::CurrentBenchmark(), binCount);
+		}
+	}
+
+	typedef void (*HistogramKernel)(uint32_t output[], const int32_t binCount, const float low, const float high, const float a[], const int64_t count);
+	typedef void (*HistogramEdgesKernel)(uint32_t output[], const float edges[], const int32_t binCount, const float a[], const int64_t count);
+
+	void FixedWidthHistogram(picobench::state& s, HistogramKernel kernel, const int binCount)
+	{
+		CountHistogram(s, [kernel, binCount](vector<uint32_t>& output, const vector<float>&, const vector<float>& a)
+		{
+			kernel(output.data(), binCount, HISTOGRAM_LOW, HISTOGRAM_HIGH, a.data(), a.size());
+		}, binCount, false);
+	}
+
+	void ExplicitEdgeHistogram(picobench::state& s, HistogramEdgesKernel kernel, const int binCount)
+	{
+		CountHistogram(s, [kernel, binCount](vector<uint32_t>& output, const vector<float>& edges, const vector<float>& a)
+		{
+			kernel(output.data(), edges.data(), binCount, a.data(), a.size());
+		}, binCount, true);
+	}
+}
+
+
+PICOBENCH_SUITE("Histogram");
+
+static void Histogram_B16_CPP(picobench::state& s)
+{
+	CountHistogram(s, [](vector<uint32_t>& output, const vector<float>&, const vector<float>& a)
+	{
+		Histogram(output, 16, HISTOGRAM_LOW, HISTOGRAM_HIGH, a, a.size());
+	}, 16, false);
+}
+PICOBENCH_THROUGHPUT(Histogram_B16_CPP, 4);
+
+static void Histogram_B16_ISPC(picobench::state& s)
+{
+	FixedWidthHistogram(s, ISPC_KERNEL(Histogram), 16);
+}
+PICOBENCH_THROUGHPUT(Histogram_B16_ISPC, 4);
+
+static void Histogram_B16_ISPC_Tasks(picobench::state& s)
+{
+	TaskSys::SetThreadCount(static_cast<int>(s.user_data()));
+
+	FixedWidthHistogram(s, ISPC_KERNEL(Histogram_Tasks), 16);
+}
+PICOBENCH_THREAD_SWEEP(Histogram_B16_ISPC_Tasks, 4);
+
+static void Histogram_B256_CPP(picobench::state& s)
+{
+	CountHistogram(s, [](vector<uint32_t>& output, const vector<float>&, const vector<float>& a)
+	{
+		Histogram(output, 256, HISTOGRAM_LOW, HISTOGRAM_HIGH, a, a.size());
+	}, 256, false);
+}
+PICOBENCH_THROUGHPUT(Histogram_B256_CPP, 4);
+
+static void Histogram_B256_ISPC(picobench::state& s)
+{
+	FixedWidthHistogram(s, ISPC_KERNEL(Histogram), 256);
+}
+PICOBENCH_THROUGHPUT(Histogram_B256_ISPC, 4);
+
+static void Histogram_B256_ISPC_Tasks(picobench::state& s)
+{
+	TaskSys::SetThreadCount(static_cast<int>(s.user_data()));
+
+	FixedWidthHistogram(s, ISPC_KERNEL(Histogram_Tasks), 256);
+}
+PICOBENCH_THREAD_SWEEP(Histogram_B256_ISPC_Tasks, 4);
+
+static void Histogram_B4096_CPP(picobench::state& s)
+{
+	CountHistogram(s, [](vector<uint32_t>& output, const vector<float>&, const vector<float>& a)
+	{
+		Histogram(output, 4096, HISTOGRAM_LOW, HISTOGRAM_HIGH, a, a.size());
+	}, 4096, false);
+}
+PICOBENCH_THROUGHPUT(Histogram_B4096_CPP, 4);
+
+static void Histogram_B4096_ISPC(picobench::state& s)
+{
+	FixedWidthHistogram(s, ISPC_KERNEL(Histogram), 4096);
+}
+PICOBENCH_THROUGHPUT(Histogram_B4096_ISPC, 4);
+
+static void Histogram_B4096_ISPC_Tasks(picobench::state& s)
+{
+	TaskSys::SetThreadCount(static_cast<int>(s.user_data()));
+
+	FixedWidthHistogram(s, ISPC_KERNEL(Histogram_Tasks), 4096);
+}
+PICOBENCH_THREAD_SWEEP(Histogram_B4096_ISPC_Tasks, 4);
+
+
+PICOBENCH_SUITE("HistogramEdges");
+
+static void HistogramEdges_B16_CPP(picobench::state& s)
+{
+	CountHistogram(s, [](vector<uint32_t>& output, const vector<float>& edges, const vector<float>& a)
+	{
+		HistogramEdges(output, edges, 16, a, a.size());
+	}, 16, true);
+}
+PICOBENCH_THROUGHPUT(HistogramEdges_B16_CPP, 4);
+
+static void HistogramEdges_B16_ISPC(picobench::state& s)
+{
+	ExplicitEdgeHistogram(s, ISPC_KERNEL(HistogramEdges), 16);
+}
+PICOBENCH_THROUGHPUT(HistogramEdges_B16_ISPC, 4);
+
+static void HistogramEdges_B16_ISPC_Tasks(picobench::state& s)
+{
+	TaskSys::SetThreadCount(static_cast<int>(s.user_data()));
+
+	ExplicitEdgeHistogram(s, ISPC_KERNEL(HistogramEdges_Tasks), 16);
+}
+PICOBENCH_THREAD_SWEEP(HistogramEdges_B16_ISPC_Tasks, 4);
+
+static void HistogramEdges_B256_CPP(picobench::state& s)
+{
+	CountHistogram(s, [](vector<uint32_t>& output, const vector<float>& edges, const vector<float>& a)
+	{
+		HistogramEdges(output, edges, 256, a, a.size());
+	}, 256, true);
+}
+PICOBENCH_THROUGHPUT(HistogramEdges_B256_CPP, 4);
+
+static void HistogramEdges_B256_ISPC(picobench::state& s)
+{
+	ExplicitEdgeHistogram(s, ISPC_KERNEL(HistogramEdges), 256);
+}
+PICOBENCH_THROUGHPUT(HistogramEdges_B256_ISPC, 4);
+
+static void HistogramEdges_B256_ISPC_Tasks(picobench::state& s)
+{
+	TaskSys::SetThreadCount(static_cast<int>(s.user_data()));
+
+	ExplicitEdgeHistogram(s, ISPC_KERNEL(HistogramEdges_Tasks), 256);
+}
+PICOBENCH_THREAD_SWEEP(HistogramEdges_B256_ISPC_Tasks, 4);
+
+static void HistogramEdges_B4096_CPP(picobench::state& s)
+{
+	CountHistogram(s, [](vector<uint32_t>& output, const vector<float>& edges, const vector<float>& a)
+	{
+		HistogramEdges(output, edges, 4096, a, a.size());
+	}, 4096, true);
+}
+PICOBENCH_THROUGHPUT(HistogramEdges_B4096_CPP, 4);
+
+static void HistogramEdges_B4096_ISPC(picobench::state& s)
+{
+	ExplicitEdgeHistogram(s, ISPC_KERNEL(HistogramEdges), 4096);
+}
+PICOBENCH_THROUGHPUT(HistogramEdges_B4096_ISPC, 4);
+
+static void HistogramEdges_B4096_ISPC_Tasks(picobench::state& s)
+{
+	TaskSys::SetThreadCount(static_cast<int>(s.user_data()));
+
+	ExplicitEdgeHistogram(s, ISPC_KERNEL(HistogramEdges_Tasks), 4096);
+}
+PICOBENCH_THREAD_SWEEP(HistogramEdges_B4096_ISPC_Tasks, 4);
+
+
+// sum(a + b), min(a * b), max(a * s + b) and dot(a, b) over Dim elements. _Unfused writes the expression
+// to a temporary array (allocated up front) and reduces that, _Fused goes through the Fused API in
+// part_1.h and reads a and b once. Throughput counts the 8 bytes of a and b per element for both.
+#define FUSED_SCALE 0.5f
+
+namespace
+{
+	// runs reduce(a, b, temporary) and reports its relative error against reference(a[i], b[i]) combined in long double
+	template <typename Reduce, typename Reference, typename Combine>
+	void FusedReduction(picobench::state& s, Reduce&& reduce, Reference&& reference, Combine&& combine, const long double identity)
+	{
+		vector<float> a;
+		vector<float> b;
+		vector<float> temporary(s.iterations());
+		float output = 0.0f;
+
+		InitializeDoubleArray(a, b, s.iterations());
+
+		const int repetitions = Bench::Repetitions(s);
+
+		Bench::StartTimer(s);
+
+		#pragma loop(no_vector)
+		for (int i = 0; i < repetitions; ++i)
+		{
+			output = reduce(a, b, temporary);
+
+			s.set_result((uintptr_t)output);
+		}
+
+		Bench::StopTimer(s); // Manual stop
+
+		long double expected = identity;
+		for (size_t i = 0; i < a.size(); ++i)
+		{
+			expected = combine(expected, reference(a[i], b[i]));
+		}
+
+		Bench::SetError(s, output, expected);
+	}
+
+	long double ReferenceAdd(const float a, const float b) { return static_cast<long double>(a) + b; }
+	long double ReferenceMul(const float a, const float b) { return static_cast<long double>(a) * b; }
+	long double ReferenceMulAdd(const float a, const float b) { return static_cast<long double>(a) * FUSED_SCALE + b; }
+
+	long double CombineSum(const long double a, const long double b) { return a + b; }
+	long double CombineMin(const long double a, const long double b) { return std::min(a, b); }
+	long double CombineMax(const long double a, const long double b) { return std::max(a, b); }
+
+	// the Fused kernels for the selected target, so _Fused runs the same ISA as _ISPC_Unfused
+	Fused::Kernels SelectedFusedKernels()
+	{
+		return
+		{
+			{ ISPC_KERNEL(SumOfAdd), ISPC_KERNEL(SumOfMul), ISPC_KERNEL(SumOfMulAdd) },
+			{ ISPC_KERNEL(MinOfAdd), ISPC_KERNEL(MinOfMul), ISPC_KERNEL(MinOfMulAdd) },
+			{ ISPC_KERNEL(MaxOfAdd), ISPC_KERNEL(MaxOfMul), ISPC_KERNEL(MaxOfMulAdd) },
+		};
+	}
+}
+
+PICOBENCH_SUITE("Fused");
+
+static void SumOfAdd_CPP_Unfused(picobench::state& s)
+{
+	FusedReduction(s, [](const vector<float>& a, const vector<float>& b, vector<float>& temporary)
+	{
+		float output;
+		AddArrayElements(temporary, a, b, a.size());
+		SumArray(output, temporary, temporary.size());
+		return output;
+	}, ReferenceAdd, CombineSum, 0.0L);
+}
+PICOBENCH_THROUGHPUT(SumOfAdd_CPP_Unfused, 8);
+
+static void SumOfAdd_ISPC_Unfused(picobench::state& s)
+{
+	FusedReduction(s, [](const vector<float>& a, const vector<float>& b, vector<float>& temporary)
+	{
+		float output;
+		ISPC_KERNEL(AddArrayElements)(temporary.data(), a.data(), b.data(), a.size());
+		ISPC_KERNEL(SumArray)(output, temporary.data(), temporary.size());
+		return output;
+	}, ReferenceAdd, CombineSum, 0.0L);
+}
+PICOBENCH_THROUGHPUT(SumOfAdd_ISPC_Unfused, 8);
+
+static void SumOfAdd_ISPC_Fused(picobench::state& s)
+{
+	const Fused::Kernels kernels = SelectedFusedKernels();
+	FusedReduction(s, [&kernels](const vector<float>& a, const vector<float>& b, vector<float>&)
+	{
+		return Fused::Sum(Fused::Add(a, b), a.size(), kernels);
+	}, ReferenceAdd, CombineSum, 0.0L);
+}
+PICOBENCH_THROUGHPUT(SumOfAdd_ISPC_Fused, 8);
+
+static void MinOfMul_CPP_Unfused(picobench::state& s)
+{
+	FusedReduction(s, [](const vector<float>& a, const vector<float>& b, vector<float>& temporary)
+	{
+		float output;
+		MulArrayElements(temporary, a, b, a.size());
+		MinArray(output, temporary, temporary.size());
+		return output;
+	}, ReferenceMul, CombineMin, FLT_MAX);
+}
+PICOBENCH_THROUGHPUT(MinOfMul_CPP_Unfused, 8);
+
+static void MinOfMul_ISPC_Unfused(picobench::state& s)
+{
+	FusedReduction(s, [](const vector<float>& a, const vector<float>& b, vector<float>& temporary)
+	{
+		float output;
+		ISPC_KERNEL(MulArrayElements)(temporary.data(), a.data(), b.data(), a.size());
+		ISPC_KERNEL(MinArray)(output, temporary.data(), temporary.size());
+		return output;
+	}, ReferenceMul, CombineMin, FLT_MAX);
+}
+PICOBENCH_THROUGHPUT(MinOfMul_ISPC_Unfused, 8);
+
+static void MinOfMul_ISPC_Fused(picobench::state& s)
+{
+	const Fused::Kernels kernels = SelectedFusedKernels();
+	FusedReduction(s, [&kernels](const vector<float>& a, const vector<float>& b, vector<float>&)
+	{
+		return Fused::Min(Fused::Mul(a, b), a.size(), kernels);
+	}, ReferenceMul, CombineMin, FLT_MAX);
+}
+PICOBENCH_THROUGHPUT(MinOfMul_ISPC_Fused, 8);
+
+static void MaxOfMulAdd_CPP_Unfused(picobench::state& s)
+{
+	FusedReduction(s, [](const vector<float>& a, const vector<float>& b, vector<float>& temporary)
+	{
+		float output;
+		MulAddArrayElements(temporary, a, FUSED_SCALE, b, a.size());
+		MaxArray(output, temporary, temporary.size());
+		return output;
+	}, ReferenceMulAdd, CombineMax, -FLT_MAX);
+}
+PICOBENCH_THROUGHPUT(MaxOfMulAdd_CPP_Unfused, 8);
+
+static void MaxOfMulAdd_ISPC_Unfused(picobench::state& s)
+{
+	FusedReduction(s, [](const vector<float>& a, const vector<float>& b, vector<float>& temporary)
+	{
+		float output;
+		ISPC_KERNEL(MulAddArrayElements)(temporary.data(), a.data(), FUSED_SCALE, b.data(), a.size());
+		ISPC_KERNEL(MaxArray)(output, temporary.data(), temporary.size());
+		return output;
+	}, ReferenceMulAdd, CombineMax, -FLT_MAX);
+}
+PICOBENCH_THROUGHPUT(MaxOfMulAdd_ISPC_Unfused, 8);
+
+static void MaxOfMulAdd_ISPC_Fused(picobench::state& s)
+{
+	const Fused::Kernels kernels = SelectedFusedKernels();
+	FusedReduction(s, [&kernels](const vector<float>& a, const vector<float>& b, vector<float>&)
+	{
+		return Fused::Max(Fused::MulAdd(a, FUSED_SCALE, b), a.size(), kernels);
+	}, ReferenceMulAdd, CombineMax, -FLT_MAX);
+}
+PICOBENCH_THROUGHPUT(MaxOfMulAdd_ISPC_Fused, 8);
+
+static void Dot_CPP_Unfused(picobench::state& s)
+{
+	FusedReduction(s, [](const vector<float>& a, const vector<float>& b, vector<float>& temporary)
+	{
+		float output;
+		MulArrayElements(temporary, a, b, a.size());
+		SumArray(output, temporary, temporary.size());
+		return output;
+	}, ReferenceMul, CombineSum, 0.0L);
+}
+PICOBENCH_THROUGHPUT(Dot_CPP_Unfused, 8);
+
+static void Dot_ISPC_Unfused(picobench::state& s)
+{
+	FusedReduction(s, [](const vector<float>& a, const vector<float>& b, vector<float>& temporary)
+	{
+		float output;
+		ISPC_KERNEL(MulArrayElements)(temporary.data(), a.data(), b.data(), a.size());
+		ISPC_KERNEL(SumArray)(output, temporary.data(), temporary.size());
+		return output;
+	}, ReferenceMul, CombineSum, 0.0L);
+}
+PICOBENCH_THROUGHPUT(Dot_ISPC_Unfused, 8);
+
+static void Dot_ISPC_Fused(picobench::state& s)
+{
+	const Fused::Kernels kernels = SelectedFusedKernels();
+	FusedReduction(s, [&kernels](const vector<float>& a, const vector<float>& b, vector<float>&)
+	{
+		return Fused::Dot(a, b, a.size(), kernels);
+	}, ReferenceMul, CombineSum, 0.0L);
+}
+PICOBENCH_THROUGHPUT(Dot_ISPC_Fused, 8);
+
+
+PICOBENCH_SUITE("Convert16Bit");
+
+namespace
+{
+	void ConvertFloatTo16Bit(picobench::state& s, FloatTo16BitKernel kernel)
+	{
+		vector<uint16_t> output(s.iterations());
+		vector<float> a;
+
+		InitializeArray(a, s.iterations());
+
+		const int repetitions = Bench::Repetitions(s);
+
+		Bench::StartTimer(s);
+
+		#pragma loop(no_vector)
+		for (int i = 0; i < repetitions; ++i)
+		{
+			kernel(output.data(), a.data(), s.iterations());
+
+			s.set_result((uintptr_t)&output);
+		}
+
+		Bench::StopTimer(s); // Manual stop
+	}
+
+	typedef void (*Float16BitToFloatKernel)(float output[], const uint16_t input[], const int64_t count);
+
+	void Convert16BitToFloat(picobench::state& s, FloatTo16BitKernel convert, Float16BitToFloatKernel kernel)
+	{
+		vector<float> output(s.iterations());
+		vector<uint16_t> a;
+
+		Initialize16BitArray(a, s.iterations(), convert);
+
+		const int repetitions = Bench::Repetitions(s);
+
+		Bench::StartTimer(s);
+
+		#pragma loop(no_vector)
+		for (int i = 0; i < repetitions; ++i)
+		{
+			kernel(output.data(), a.data(), s.iterations());
+
+			s.set_result((uintptr_t)&output);
+		}
+
+		Bench::StopTimer(s); // Manual stop
+	}
+}
+
+static void FloatToHalf_ISPC(picobench::state& s)
+{
+	ConvertFloatTo16Bit(s, ISPC_KERNEL(FloatToHalfArray));
+}
+PICOBENCH_THROUGHPUT(FloatToHalf_ISPC, 6);
+
+static void HalfToFloat_ISPC(picobench::state& s)
+{
+	Convert16BitToFloat(s, ISPC_KERNEL(FloatToHalfArray), ISPC_KERNEL(HalfToFloatArray));
+}
+PICOBENCH_THROUGHPUT(HalfToFloat_ISPC, 6);
+
+static void FloatToBFloat16_ISPC(picobench::state& s)
+{
+	ConvertFloatTo16Bit(s, ISPC_KERNEL(FloatToBFloat16Array));
+}
+PICOBENCH_THROUGHPUT(FloatToBFloat16_ISPC, 6);
+
+static void BFloat16ToFloat_ISPC(picobench::state& s)
+{
+	Convert16BitToFloat(s, ISPC_KERNEL(FloatToBFloat16Array), ISPC_KERNEL(BFloat16ToFloatArray));
+}
+PICOBENCH_THROUGHPUT(BFloat16ToFloat_ISPC, 6);
+
+
+// AddArrayElements over 3 arrays of up to 256M elements (3GB in total)
+#define STREAMING_SIZES {1 << 20, 1 << 22, 1 << 24, 1 << 26, 1 << 28}
+
+namespace
+{
+	typedef void (*AddArrayElementsKernel)(float output[], const float a[], const float b[], const int64_t count);
+
+	void AddArrayElementsLarge(picobench::state& s, AddArrayElementsKernel kernel)
+	{
+		// value-initialized, so the output pages are touched before the timer starts
+		vector<float> output(s.iterations());
+		vector<float> a;
+		vector<float> b;
+
+		a.reserve(s.iterations());
+		b.reserve(s.iterations());
+
+		InitializeDoubleArray(a, b, s.iterations());
+
+		const int repetitions = Bench::Repetitions(s);
+
+		Bench::StartTimer(s);
+
+		#pragma loop(no_vector)
+		for (int i = 0; i < repetitions; ++i)
+		{
+			kernel(output.data(), a.data(), b.data(), s.iterations());
+		}
+
+		Bench::StopTimer(s); // Manual stop
+
+		s.set_result((uintptr_t)output.back());
+	}
+}
+
+PICOBENCH_SUITE("AddArrayElements_Streaming");
+
+static void AddArrayElements_ISPC_Stores(picobench::state& s)
+{
+	AddArrayElementsLarge(s, ISPC_KERNEL(AddArrayElements));
+}
+PICOBENCH_THROUGHPUT(AddArrayElements_ISPC_Stores, 12).iterations(STREAMING_SIZES);
+
+static void AddArrayElements_ISPC_NonTemporal(picobench::state& s)
+{
+	AddArrayElementsLarge(s, ISPC_KERNEL(AddArrayElements_NonTemporal));
+}
+PICOBENCH_THROUGHPUT(AddArrayElements_ISPC_NonTemporal, 12).iterations(STREAMING_SIZES);
+
+static void AddArrayElements_ISPC_Streaming(picobench::state& s)
+{
+	AddArrayElementsLarge(s, ISPC_KERNEL(AddArrayElements_Streaming));
+}
+PICOBENCH_THROUGHPUT(AddArrayElements_ISPC_Streaming, 12).iterations(STREAMING_SIZES);
+
+
+// AddArrayElements_Tasks over DRAM sized arrays from std::allocator and from each Memory::Allocator placement
+// (see common/allocator.h). The arrays are allocated and filled before the timer starts, so only the kernel
+// is timed, and --perf shows the difference in TLB and cache misses.
+#define ALLOCATION_SIZES {1 << 24, 1 << 26, 1 << 28}
+
+namespace
+{
+	template <typename Alloc>
+	void AddArrayElementsPlaced(picobench::state& s, const Alloc& allocator)
+	{
+		std::vector<float, Alloc> output(s.iterations(), 0.0f, allocator);
+		std::vector<float, Alloc> a(s.iterations(), 0.0f, allocator);
+		std::vector<float, Alloc> b(s.iterations(), 0.0f, allocator);
+
+		ISPC_KERNEL(FillRandom_Tasks)(a.data(), s.iterations(), RAND_SEED_A, 0.0f, 10.0f);
+		ISPC_KERNEL(FillRandom_Tasks)(b.data(), s.iterations(), RAND_SEED_B, 0.0f, 10.0f);
+
+		const int repetitions = Bench::Repetitions(s);
+
+		Bench::StartTimer(s);
+
+		#pragma loop(no_vector)
+		for (int i = 0; i < repetitions; ++i)
+		{
+			ISPC_KERNEL(AddArrayElements_Tasks)(output.data(), a.data(), b.data(), s.iterations());
+		}
+
+		Bench::StopTimer(s); // Manual stop
+
+		s.set_result((uintptr_t)output.back());
+	}
+
+	void AddArrayElementsWithPlacement(picobench::state& s, const uint32_t placement)
+	{
+		if ((placement & Memory::PLACEMENT_HUGE_PAGES) && !Memory::HugePagesAvailable())
+		{
+			static bool warned = false;
+
+			if (!warned)
+			{
+				fprintf(stderr, "Warning: transparent huge pages aren't available, the huge page runs use regular pages\n");
+				warned = true;
+			}
+		}
+
+		AddArrayElementsPlaced(s, Memory::Allocator<float>(placement));
+	}
+}
+
+PICOBENCH_SUITE("Allocator");
+
+static void AddArrayElements_ISPC_Tasks_StdAllocator(picobench::state& s)
+{
+	AddArrayElementsPlaced(s, std::allocator<float>());
+}
+PICOBENCH_THROUGHPUT(AddArrayElements_ISPC_Tasks_StdAllocator, 12).iterations(ALLOCATION_SIZES);
+
+static void AddArrayElements_ISPC_Tasks_Aligned(picobench::state& s)
+{
+	AddArrayElementsWithPlacement(s, Memory::PLACEMENT_ALIGNED);
+}
+PICOBENCH_THROUGHPUT(AddArrayElements_ISPC_Tasks_Aligned, 12).iterations(ALLOCATION_SIZES);
+
+static void AddArrayElements_ISPC_Tasks_HugePages(picobench::state& s)
+{
+	AddArrayElementsWithPlacement(s, Memory::PLACEMENT_HUGE_PAGES);
+}
+PICOBENCH_THROUGHPUT(AddArrayElements_ISPC_Tasks_HugePages, 12).iterations(ALLOCATION_SIZES);
+
+static void AddArrayElements_ISPC_Tasks_FirstTouch(picobench::state& s)
+{
+	AddArrayElementsWithPlacement(s, Memory::PLACEMENT_FIRST_TOUCH);
+}
+PICOBENCH_THROUGHPUT(AddArrayElements_ISPC_Tasks_FirstTouch, 12).iterations(ALLOCATION_SIZES);
+
+static void AddArrayElements_ISPC_Tasks_HugePages_FirstTouch(picobench::state& s)
+{
+	AddArrayElementsWithPlacement(s, Memory::PLACEMENT_HUGE_PAGES | Memory::PLACEMENT_FIRST_TOUCH);
+}
+PICOBENCH_THROUGHPUT(AddArrayElements_ISPC_Tasks_HugePages_FirstTouch, 12).iterations(ALLOCATION_SIZES);
+
+
+// SumArray over array files of up to 256M elements (1GB). The sizes start at ELEMENTS_PER_SAMPLE,
+// so every sample is a single pass over the file. Cold runs drop the file from the page cache
+// before the timer starts, warm runs read it once instead.
+#define FILE_SIZES {1 << 25, 1 << 26, 1 << 27, 1 << 28}
+
+namespace
+{
+	// writes one file per size to the temp directory when it's first needed, they're removed on exit
+	const char* ArrayFilePath(const size_t count)
+	{
+		static struct Files
+		{
+			std::map<size_t, std::string> paths;
+
+			~Files()
+			{
+				for (auto& path : paths)
+				{
+					std::remove(path.second.c_str());
+				}
+			}
+		} files;
+
+		const auto found = files.paths.find(count);
+		if (found != files.paths.end())
+		{
+			return found->second.c_str();
+		}
+
+		const std::string path = (std::filesystem::temp_directory_path() / ("part_1_benchmark_" + std::to_string(count) + ".bin")).string();
+
+		vector<float> a;
+		InitializeArray(a, count);
+
+		if (!ArrayFile::Write(path.c_str(), a.data(), count))
+		{
+			std::remove(path.c_str());
+			return nullptr;
+		}
+
+		return files.paths.emplace(count, path).first->second.c_str();
+	}
+
+	void PrepareCache(const char* path, const bool cold)
+	{
+		if (cold)
+		{
+			static bool warned = false;
+
+			if (!ArrayFile::DropFromPageCache(path) && !warned)
+			{
+				fprintf(stderr, "Warning: can't drop array files from the page cache, the cold runs are warm\n");
+				warned = true;
+			}
+		}
+		else
+		{
+			vector<float> a;
+			ArrayFile::Read(path, a);
+		}
+	}
+
+	void SumArrayFileRead(picobench::state& s, const bool cold)
+	{
+		const char* path = ArrayFilePath(s.iterations());
+		if (!path)
+		{
+			return;
+		}
+
+		float output = 0.0f;
+
+		// value-initialized, so only the read is timed and not the page faults
+		vector<float> a(s.iterations());
+
+		PrepareCache(path, cold);
+
+		const int repetitions = Bench::Repetitions(s);
+
+		Bench::StartTimer(s);
+
+		#pragma loop(no_vector)
+		for (int i = 0; i < repetitions; ++i)
+		{
+			ArrayFile::Read(path, a);
+			ISPC_KERNEL(SumArray)(output, a.data(), a.size());
+
+			s.set_result((uintptr_t)&output);
+		}
+
+		Bench::StopTimer(s); // Manual stop
+	}
+
+	void SumArrayFileMapped(picobench::state& s, const bool cold, const ArrayFile::MappedArray::Advice advice)
+	{
+		const char* path = ArrayFilePath(s.iterations());
+		if (!path)
+		{
+			return;
+		}
+
+		float output = 0.0f;
+
+		PrepareCache(path, cold);
+
+		const int repetitions = Bench::Repetitions(s);
+
+		Bench::StartTimer(s);
+
+		#pragma loop(no_vector)
+		for (int i = 0; i < repetitions; ++i)
+		{
+			ArrayFile::MappedArray file;
+
+			if (file.Open(path, advice))
+			{
+				ISPC_KERNEL(SumArray)(output, file.Data(), file.Size());
+			}
+
+			s.set_result((uintptr_t)&output);
+		}
+
+		Bench::StopTimer(s); // Manual stop
+	}
+}
+
+PICOBENCH_SUITE("ArrayFile");
+
+static void SumArray_File_Read_Cold(picobench::state& s)
+{
+	SumArrayFileRead(s, true);
+}
+PICOBENCH_THROUGHPUT(SumArray_File_Read_Cold, 4).iterations(FILE_SIZES);
+
+static void SumArray_File_Mmap_Cold(picobench::state& s)
+{
+	SumArrayFileMapped(s, true, ArrayFile::MappedArray::ADVICE_NORMAL);
+}
+PICOBENCH_THROUGHPUT(SumArray_File_Mmap_Cold, 4).iterations(FILE_SIZES);
+
+static void SumArray_File_Mmap_Cold_Sequential(picobench::state& s)
+{
+	SumArrayFileMapped(s, true, ArrayFile::MappedArray::ADVICE_SEQUENTIAL);
+}
+PICOBENCH_THROUGHPUT(SumArray_File_Mmap_Cold_Sequential, 4).iterations(FILE_SIZES);
+
+static void SumArray_File_Mmap_Cold_WillNeed(picobench::state& s)
+{
+	SumArrayFileMapped(s, true, ArrayFile::MappedArray::ADVICE_SEQUENTIAL_WILLNEED);
+}
+PICOBENCH_THROUGHPUT(SumArray_File_Mmap_Cold_WillNeed, 4).iterations(FILE_SIZES);
+
+static void SumArray_File_Read_Warm(picobench::state& s)
+{
+	SumArrayFileRead(s, false);
+}
+PICOBENCH_THROUGHPUT(SumArray_File_Read_Warm, 4).iterations(FILE_SIZES);
+
+static void SumArray_File_Mmap_Warm(picobench::state& s)
+{
+	SumArrayFileMapped(s, false, ArrayFile::MappedArray::ADVICE_SEQUENTIAL);
+}
+PICOBENCH_THROUGHPUT(SumArray_File_Mmap_Warm, 4).iterations(FILE_SIZES);
+
+
+// ArrayStats over the same files, streamed through a ring of 4MB chunk buffers by a reader thread
+// (ArrayFile::ChunkStream) and merged per chunk with MergeArrayStats. Memory use doesn't depend on the
+// file size. With one buffer reading and ArrayStats take turns, with two or three they overlap and
+// the time should approach the larger of _ReadOnly (just the reads) and ArrayStats_Memory (just the compute).
+#define STREAM_CHUNK_SIZE (1 << 20)
+
+namespace
+{
+	void ArrayStatsFileStream(picobench::state& s, const int bufferCount, const bool compute)
+	{
+		const char* path = ArrayFilePath(s.iterations());
+		if (!path)
+		{
+			return;
+		}
+
+		ispc::ArrayStatistics stats = {};
+		ArrayFile::ChunkStream stream(STREAM_CHUNK_SIZE, bufferCount);
+
+		PrepareCache(path, true);
+
+		const int repetitions = Bench::Repetitions(s);
+
+		Bench::StartTimer(s);
+
+		#pragma loop(no_vector)
+		for (int i = 0; i < repetitions; ++i)
+		{
+			stats = {};
+
+			stream.Run(path, [&](const float* chunk, const size_t count)
+			{
+				ispc::ArrayStatistics partial = {};
+				partial.count = static_cast<int64_t>(count);
+
+				if (compute)
+				{
+					ISPC_KERNEL(ArrayStats)(partial, chunk, count, true);
+				}
+
+				MergeArrayStats(stats, partial, true);
+			});
+		}
+
+		Bench::StopTimer(s); // Manual stop
+
+		if (stats.count != s.iterations())
+		{
+			fprintf(stderr, "%s: streamed %lld of %d elements\n", Bench::CurrentBenchmark(), static_cast<long long>(stats.count), s.iterations());
+		}
+
+		s.set_result((uintptr_t)(stats.sum + stats.min + stats.max + stats.variance));
+	}
+}
+
+PICOBENCH_SUITE("ArrayFile_Stream");
+
+static void ArrayStats_File_Stream_1_Buffer(picobench::state& s)
+{
+	ArrayStatsFileStream(s, 1, true);
+}
+PICOBENCH_THROUGHPUT(ArrayStats_File_Stream_1_Buffer, 4).iterations(FILE_SIZES);
+
+static void ArrayStats_File_Stream_2_Buffers(picobench::state& s)
+{
+	ArrayStatsFileStream(s, 2, true);
+}
+PICOBENCH_THROUGHPUT(ArrayStats_File_Stream_2_Buffers, 4).iterations(FILE_SIZES);
+
+static void ArrayStats_File_Stream_3_Buffers(picobench::state& s)
+{
+	ArrayStatsFileStream(s, 3, true);
+}
+PICOBENCH_THROUGHPUT(ArrayStats_File_Stream_3_Buffers, 4).iterations(FILE_SIZES);
+
+static void ArrayStats_File_Stream_ReadOnly(picobench::state& s)
+{
+	ArrayStatsFileStream(s, 3, false);
+}
+PICOBENCH_THROUGHPUT(ArrayStats_File_Stream_ReadOnly, 4).iterations(FILE_SIZES);
+
+static void ArrayStats_Memory(picobench::state& s)
+{
+	ispc::ArrayStatistics stats = {};
+	vector<float> a;
+
+	a.reserve(s.iterations());
+
+	InitializeArray(a, s.iterations());
+
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
+
+	#pragma loop(no_vector)
+	for (int i = 0; i < repetitions; ++i)
+	{
+		ISPC_KERNEL(ArrayStats)(stats, a.data(), s.iterations(), true);
+	}
+
+	Bench::StopTimer(s); // Manual stop
+
+	s.set_result((uintptr_t)(stats.sum + stats.min + stats.max + stats.variance));
+}
+PICOBENCH_THROUGHPUT(ArrayStats_Memory, 4).iterations(FILE_SIZES);
+
+
+int main(int argc, char* argv[])
+{
+	return Bench::Main(argc, argv, [](const int target)
+	{
+		const auto programCount = IspcTarget_GetProgramCount(target);
+		return programCount ? static_cast<int>(programCount()) : 0;
+	});
 }
-PICOBENCH(AverageArray_ISPC);
\ No newline at end of file
@@ -0,0 +1,197 @@
+// Copyright(c) 2024, Pete Brubaker <pete.brubaker@intel.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// ISPC: Making CPU SIMD fun while tracing rays!
+// Part 1
+//
+// Graphics Programming Conference 2024
+// https://www.graphicsprogrammingconference.nl/
+//
+// ISPC kernel tables and the wrappers that call through them, kept out of part_1.h
+// so the C++ reference implementations don't depend on the generated ISPC header
+//
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "part_1.h"
+#include "part_1_ispc.h"
+
+
+// Fused elementwise + reduction, see part_1.ispc
+//
+//     Fused::Sum(Fused::Add(a, b), count)           sum of a[i] + b[i]
+//     Fused::Max(Fused::MulAdd(a, s, b), count)     max of a[i] * s + b[i]
+//     Fused::Dot(a, b, count)                       sum of a[i] * b[i]
+//
+// picks the ISPC kernel for the expression from a Kernels table. The default table goes through ISPC's
+// own target dispatch, pass one built from ISPC_KERNEL to run a specific target (see part_1_benchmark.cpp)
+namespace Fused
+{
+	enum Operation
+	{
+		ADD,
+		MUL,
+		MUL_ADD,
+		OPERATION_COUNT
+	};
+
+	struct Expression
+	{
+		Operation operation;
+		const float* a;
+		const float* b;
+		float s;
+	};
+
+	inline Expression Add(const vector<float>& a, const vector<float>& b)
+	{
+		return { ADD, a.data(), b.data(), 0.f };
+	}
+
+	inline Expression Mul(const vector<float>& a, const vector<float>& b)
+	{
+		return { MUL, a.data(), b.data(), 0.f };
+	}
+
+	inline Expression MulAdd(const vector<float>& a, const float s, const vector<float>& b)
+	{
+		return { MUL_ADD, a.data(), b.data(), s };
+	}
+
+	typedef void (*Kernel)(float& output, const float a[], const float b[], const float s, const int64_t count);
+
+	// one kernel per Operation for each reduction
+	struct Kernels
+	{
+		Kernel sum[OPERATION_COUNT];
+		Kernel min[OPERATION_COUNT];
+		Kernel max[OPERATION_COUNT];
+	};
+
+	inline const Kernels& DispatchKernels()
+	{
+		static const Kernels kernels =
+		{
+			{ ispc::SumOfAdd, ispc::SumOfMul, ispc::SumOfMulAdd },
+			{ ispc::MinOfAdd, ispc::MinOfMul, ispc::MinOfMulAdd },
+			{ ispc::MaxOfAdd, ispc::MaxOfMul, ispc::MaxOfMulAdd },
+		};
+		return kernels;
+	}
+
+	// kernels holds one kernel per Operation
+	inline float Reduce(const Kernel (&kernels)[OPERATION_COUNT], const Expression& expression, const size_t count)
+	{
+		float output = 0.f;
+		kernels[expression.operation](output, expression.a, expression.b, expression.s, count);
+		return output;
+	}
+
+	inline float Sum(const Expression& expression, const size_t count, const Kernels& kernels = DispatchKernels())
+	{
+		return Reduce(kernels.sum, expression, count);
+	}
+
+	inline float Min(const Expression& expression, const size_t count, const Kernels& kernels = DispatchKernels())
+	{
+		return Reduce(kernels.min, expression, count);
+	}
+
+	inline float Max(const Expression& expression, const size_t count, const Kernels& kernels = DispatchKernels())
+	{
+		return Reduce(kernels.max, expression, count);
+	}
+
+	inline float Dot(const vector<float>& a, const vector<float>& b, const size_t count, const Kernels& kernels = DispatchKernels())
+	{
+		return Sum(Mul(a, b), count, kernels);
+	}
+}
+
+
+// the ISPC kernels for every element type under one name, e.g. Typed::SumArray(sum, a, count) for a vector<int32_t>
+// like the Fused API they take a Kernels table, the default goes through ISPC's own target dispatch.
+// The float set is the hand written float kernels, the others come from DEFINE_TYPED_KERNELS in part_1.ispc.
+namespace Typed
+{
+	template <typename T>
+	struct Kernels
+	{
+		void (*add)(T output[], const T a[], const T b[], const int64_t count);
+		void (*sum)(SumType<T>& sum_output, const T a[], const int64_t count);
+		void (*min)(T& min_output, const T a[], const int64_t count);
+		void (*max)(T& max_output, const T a[], const int64_t count);
+		void (*average)(AverageType<T>& avg_output, const T a[], const int64_t count);
+	};
+
+	template <typename T>
+	const Kernels<T>& DispatchKernels();
+
+#define ISPC_TYPED_KERNELS(TYPE, SUFFIX) \
+	template <> \
+	inline const Kernels<TYPE>& DispatchKernels<TYPE>() \
+	{ \
+		static const Kernels<TYPE> kernels = \
+		{ \
+			ispc::AddArrayElements##SUFFIX, ispc::SumArray##SUFFIX, ispc::MinArray##SUFFIX, ispc::MaxArray##SUFFIX, ispc::AverageArray##SUFFIX \
+		}; \
+		return kernels; \
+	}
+
+	ISPC_TYPED_KERNELS(float, )
+	ISPC_TYPED_KERNELS(double, _Double)
+	ISPC_TYPED_KERNELS(int32_t, _Int32)
+	ISPC_TYPED_KERNELS(int64_t, _Int64)
+
+#undef ISPC_TYPED_KERNELS
+
+	template <typename T>
+	inline void AddArrayElements(vector<T>& output, const vector<T>& a, const vector<T>& b, const size_t count, const Kernels<T>& kernels = DispatchKernels<T>())
+	{
+		kernels.add(output.data(), a.data(), b.data(), count);
+	}
+
+	template <typename T>
+	inline void SumArray(SumType<T>& sum_output, const vector<T>& a, const size_t count, const Kernels<T>& kernels = DispatchKernels<T>())
+	{
+		kernels.sum(sum_output, a.data(), count);
+	}
+
+	template <typename T>
+	inline void MinArray(T& min_output, const vector<T>& a, const size_t count, const Kernels<T>& kernels = DispatchKernels<T>())
+	{
+		kernels.min(min_output, a.data(), count);
+	}
+
+	template <typename T>
+	inline void MaxArray(T& max_output, const vector<T>& a, const size_t count, const Kernels<T>& kernels = DispatchKernels<T>())
+	{
+		kernels.max(max_output, a.data(), count);
+	}
+
+	template <typename T>
+	inline void AverageArray(AverageType<T>& avg_output, const vector<T>& a, const size_t count, const Kernels<T>& kernels = DispatchKernels<T>())
+	{
+		kernels.average(avg_output, a.data(), count);
+	}
+}
@@ -22,6 +22,7 @@
 
 #include <vector>
 #include <algorithm>
+#include <cmath>
 #include <float.h>
 #include "vector3.h"
 
@@ -34,4 +35,108 @@ static inline void DotProductCpp(vector<float>& dst, const vector<Types::Vector3
 	{
 		dst[i] = src[i].x * src[i].x + src[i].y * src[i].y + src[i].z * src[i].z;
 	}
-}
\ No newline at end of file
+}
+
+// Batched Vector3 math references, on AoS data
+// Matrices are row major, see the Batched Vector3 math section of part_2.ispc.
+
+static inline float Dot(const Types::Vector3& a, const Types::Vector3& b)
+{
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static inline void DotCpp(vector<float>& dst, const vector<Types::Vector3>& a, const vector<Types::Vector3>& b, const size_t count)
+{
+	#pragma loop(no_vector)
+	for (size_t i = 0; i < count; ++i)
+	{
+		dst[i] = Dot(a[i], b[i]);
+	}
+}
+
+static inline void CrossCpp(vector<Types::Vector3>& dst, const vector<Types::Vector3>& a, const vector<Types::Vector3>& b, const size_t count)
+{
+	#pragma loop(no_vector)
+	for (size_t i = 0; i < count; ++i)
+	{
+		dst[i].x = a[i].y * b[i].z - a[i].z * b[i].y;
+		dst[i].y = a[i].z * b[i].x - a[i].x * b[i].z;
+		dst[i].z = a[i].x * b[i].y - a[i].y * b[i].x;
+	}
+}
+
+static inline void LengthCpp(vector<float>& dst, const vector<Types::Vector3>& a, const size_t count)
+{
+	#pragma loop(no_vector)
+	for (size_t i = 0; i < count; ++i)
+	{
+		dst[i] = std::sqrt(Dot(a[i], a[i]));
+	}
+}
+
+// zero vectors stay zero
+static inline void NormalizeCpp(vector<Types::Vector3>& dst, const vector<Types::Vector3>& a, const size_t count)
+{
+	#pragma loop(no_vector)
+	for (size_t i = 0; i < count; ++i)
+	{
+		const float lengthSquared = Dot(a[i], a[i]);
+		const float scale = lengthSquared > 0.f ? 1.f / std::sqrt(lengthSquared) : 0.f;
+
+		dst[i] = { a[i].x * scale, a[i].y * scale, a[i].z * scale };
+	}
+}
+
+static inline void LerpCpp(vector<Types::Vector3>& dst, const vector<Types::Vector3>& a, const vector<Types::Vector3>& b, const float t, const size_t count)
+{
+	#pragma loop(no_vector)
+	for (size_t i = 0; i < count; ++i)
+	{
+		dst[i].x = a[i].x + (b[i].x - a[i].x) * t;
+		dst[i].y = a[i].y + (b[i].y - a[i].y) * t;
+		dst[i].z = a[i].z + (b[i].z - a[i].z) * t;
+	}
+}
+
+// m is 3x4
+static inline void TransformPoints3x4Cpp(vector<Types::Vector3>& dst, const vector<Types::Vector3>& a, const float* m, const size_t count)
+{
+	#pragma loop(no_vector)
+	for (size_t i = 0; i < count; ++i)
+	{
+		const Types::Vector3 v = a[i];
+
+		dst[i].x = m[0] * v.x + m[1] * v.y + m[2] * v.z + m[3];
+		dst[i].y = m[4] * v.x + m[5] * v.y + m[6] * v.z + m[7];
+		dst[i].z = m[8] * v.x + m[9] * v.y + m[10] * v.z + m[11];
+	}
+}
+
+// m is 4x4, the result is divided by w
+static inline void TransformPoints4x4Cpp(vector<Types::Vector3>& dst, const vector<Types::Vector3>& a, const float* m, const size_t count)
+{
+	#pragma loop(no_vector)
+	for (size_t i = 0; i < count; ++i)
+	{
+		const Types::Vector3 v = a[i];
+		const float scale = 1.f / (m[12] * v.x + m[13] * v.y + m[14] * v.z + m[15]);
+
+		dst[i].x = (m[0] * v.x + m[1] * v.y + m[2] * v.z + m[3]) * scale;
+		dst[i].y = (m[4] * v.x + m[5] * v.y + m[6] * v.z + m[7]) * scale;
+		dst[i].z = (m[8] * v.x + m[9] * v.y + m[10] * v.z + m[11]) * scale;
+	}
+}
+
+// m is 3x4, only the upper 3x3 is applied (pass the inverse transpose for non-uniform scales)
+static inline void TransformNormalsCpp(vector<Types::Vector3>& dst, const vector<Types::Vector3>& a, const float* m, const size_t count)
+{
+	#pragma loop(no_vector)
+	for (size_t i = 0; i < count; ++i)
+	{
+		const Types::Vector3 v = a[i];
+
+		dst[i].x = m[0] * v.x + m[1] * v.y + m[2] * v.z;
+		dst[i].y = m[4] * v.x + m[5] * v.y + m[6] * v.z;
+		dst[i].z = m[8] * v.x + m[9] * v.y + m[10] * v.z;
+	}
+}
@@ -18,16 +18,63 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
-#define PICOBENCH_IMPLEMENT_WITH_MAIN
-#define PICOBENCH_DEFAULT_ITERATIONS {4096, 8192, 16384, 32768}
-#include "picobench/picobench.hpp"
+#include "benchmark.h"
+
+#include <cmath>
+#include <cstdio>
 
 #include "part_2.h"
 #include "part_2_ispc.h"
+#include "tasksys.h"
 #include "vector3.h"
 
 using std::vector;
 
+// per-target entry points, selected with --ispc-target
+ISPC_DECLARE_TARGETS(GetProgramCount);
+ISPC_DECLARE_TARGETS(DotProductAoS);
+ISPC_DECLARE_TARGETS(DotProductAoSoA);
+ISPC_DECLARE_TARGETS(DotProductSoA);
+ISPC_DECLARE_TARGETS(AoSToSoA);
+ISPC_DECLARE_TARGETS(SoAToAoS);
+ISPC_DECLARE_TARGETS(AoSToAoSoA);
+ISPC_DECLARE_TARGETS(AoSoAToAoS);
+ISPC_DECLARE_TARGETS(SoAToAoSoA);
+ISPC_DECLARE_TARGETS(AoSoAToSoA);
+ISPC_DECLARE_TARGETS(AoSToSoA_Tasks);
+ISPC_DECLARE_TARGETS(SoAToAoS_Tasks);
+ISPC_DECLARE_TARGETS(AoSToAoSoA_Tasks);
+ISPC_DECLARE_TARGETS(AoSoAToAoS_Tasks);
+ISPC_DECLARE_TARGETS(SoAToAoSoA_Tasks);
+ISPC_DECLARE_TARGETS(AoSoAToSoA_Tasks);
+ISPC_DECLARE_TARGETS(FillRandomAoS_Tasks);
+ISPC_DECLARE_TARGETS(FillRandomAoSoA_Tasks);
+ISPC_DECLARE_TARGETS(FillRandomSoA_Tasks);
+ISPC_DECLARE_TARGETS(DotAoS);
+ISPC_DECLARE_TARGETS(DotSoA);
+ISPC_DECLARE_TARGETS(DotAoSoA);
+ISPC_DECLARE_TARGETS(CrossAoS);
+ISPC_DECLARE_TARGETS(CrossSoA);
+ISPC_DECLARE_TARGETS(CrossAoSoA);
+ISPC_DECLARE_TARGETS(LengthAoS);
+ISPC_DECLARE_TARGETS(LengthSoA);
+ISPC_DECLARE_TARGETS(LengthAoSoA);
+ISPC_DECLARE_TARGETS(NormalizeAoS);
+ISPC_DECLARE_TARGETS(NormalizeSoA);
+ISPC_DECLARE_TARGETS(NormalizeAoSoA);
+ISPC_DECLARE_TARGETS(LerpAoS);
+ISPC_DECLARE_TARGETS(LerpSoA);
+ISPC_DECLARE_TARGETS(LerpAoSoA);
+ISPC_DECLARE_TARGETS(TransformPoints3x4AoS);
+ISPC_DECLARE_TARGETS(TransformPoints3x4SoA);
+ISPC_DECLARE_TARGETS(TransformPoints3x4AoSoA);
+ISPC_DECLARE_TARGETS(TransformPoints4x4AoS);
+ISPC_DECLARE_TARGETS(TransformPoints4x4SoA);
+ISPC_DECLARE_TARGETS(TransformPoints4x4AoSoA);
+ISPC_DECLARE_TARGETS(TransformNormalsAoS);
+ISPC_DECLARE_TARGETS(TransformNormalsSoA);
+ISPC_DECLARE_TARGETS(TransformNormalsAoSoA);
+
 namespace
 {
 	using Types::Vector3;
@@ -36,78 +83,99 @@ namespace
 	// we're using static seeds so we get the same numbers every time
 	static constexpr uint32_t RAND_SEED = 0xBAAABAAA;
 
-	// get a random float
-	static inline float GetRandFloat(std::mt19937& generator)
-	{
-		return (float)generator() / (float)generator.max();
-	}
+	// the fills run on every core, and component c of element i gets the same value in every layout
+	// (see common/random.isph)
 
 
 	// initialize an AoS vector
-	void InitializeAoS(vector<Vector3>& vec, const size_t count)
+	void InitializeAoS(vector<Vector3>& vec, const size_t count, const uint32_t seed = RAND_SEED)
 	{
-		std::mt19937 generator(RAND_SEED);
-
 		vec.resize(count);
 
-		for (size_t i = 0; i < count; ++i)
-		{
-			vec[i].x = GetRandFloat(generator);
-			vec[i].y = GetRandFloat(generator);
-			vec[i].z = GetRandFloat(generator);
-		}
+		ISPC_KERNEL(FillRandomAoS_Tasks)((ispc::Vector3*) vec.data(), count, seed);
 	}
 
 	// initialize an aligned AoS vector
 	void InitializeAoS_SSE(vector<Vector3_SSE>& vec, const size_t count)
 	{
-		vec.resize(count);
+		vector<Vector3> temp;
+		InitializeAoS(temp, count);
 
-		// initialize temp with random data
-		std::mt19937 generator(RAND_SEED);
+		vec.resize(count);
 
 		for (size_t i = 0; i < count; ++i)
 		{
-			vec[i].m_vec = _mm_setr_ps( GetRandFloat(generator), GetRandFloat(generator), GetRandFloat(generator), 1.0f);
+			vec[i].m_vec = _mm_setr_ps(temp[i].x, temp[i].y, temp[i].z, 1.0f);
 		}
 	}
 
 	// initialize an SoA vector
-	void InitializeSoA(std::vector<float>& x, std::vector<float>& y, std::vector<float>& z, const size_t count)
+	void InitializeSoA(std::vector<float>& x, std::vector<float>& y, std::vector<float>& z, const size_t count, const uint32_t seed = RAND_SEED)
 	{
-		std::mt19937 generator(RAND_SEED);
-
 		x.resize(count, 0.f);
 		y.resize(count, 0.f);
 		z.resize(count, 0.f);
 
+		ISPC_KERNEL(FillRandomSoA_Tasks)(x.data(), y.data(), z.data(), count, seed);
+	}
+
+	// initialize an AoSoA vector, Width has to match the gang width of the ISPC target being run
+	template <size_t Width>
+	void InitializeAoSoA(Types::AoSoA<Vector3, Width>& vec, const size_t count, const uint32_t seed = RAND_SEED)
+	{
+		vec.Resize(count);
+
+		ISPC_KERNEL(FillRandomAoSoA_Tasks)(vec.Data(), count, seed);
+	}
+
+	// check a dot product result against DotProductCpp on the same data
+	bool VerifyDotProduct(const char* name, const vector<float>& output, const size_t count)
+	{
+		vector<Vector3> vec;
+		vector<float> expected(count, 0.f);
+
+		InitializeAoS(vec, count);
+		DotProductCpp(expected, vec, count);
+
 		for (size_t i = 0; i < count; ++i)
 		{
-			x[i] = GetRandFloat(generator);
-			y[i] = GetRandFloat(generator);
-			z[i] = GetRandFloat(generator);
+			if (std::fabs(output[i] - expected[i]) > 1e-5f * std::max(1.f, std::fabs(expected[i])))
+			{
+				fprintf(stderr, "%s: mismatch at %zu (%f != %f)\n", name, i, output[i], expected[i]);
+				return false;
+			}
 		}
+
+		return true;
 	}
 
-	// initialize an AoSoA vector
-	void InitializeAoSoA(std::vector<float>& vec, const size_t count)
+	// the AVX-512 intrinsic baselines need AVX-512F, which every AVX-512 ISPC target implies
+	bool HostSupportsAVX512(const char* name)
 	{
-		std::mt19937 generator(RAND_SEED);
+		if (!Bench::HostSupportsIspcTarget("avx512skx"))
+		{
+			fprintf(stderr, "%s: needs AVX-512\n", name);
+			return false;
+		}
 
-		int programCount = ispc::GetProgramCount();
+		return true;
+	}
 
-		/// resize the vector
-		vec.resize(count * (programCount * 3));
+	// the AoSoA block width has to match the gang width of the ISPC target being run,
+	// calls proc.template operator()<Width>() with that width
+	template <typename Proc>
+	void WithAoSoAWidth(const char* name, Proc&& proc)
+	{
+		const int programCount = ISPC_KERNEL(GetProgramCount)();
 
-		// iterate through the structures
-		for (size_t v = 0; v < count; v += (programCount * 3))
+		switch (programCount)
 		{
-			for (size_t i = v; i < programCount; ++i)
-			{
-				vec[i] = GetRandFloat(generator);
-				vec[i + programCount] = GetRandFloat(generator);
-				vec[i + (programCount * 2)] = GetRandFloat(generator);
-			}
+		case 4: proc.template operator()<4>(); break;
+		case 8: proc.template operator()<8>(); break;
+		case 16: proc.template operator()<16>(); break;
+		case 32: proc.template operator()<32>(); break;
+		case 64: proc.template operator()<64>(); break;
+		default: fprintf(stderr, "%s: no AoSoA layout for a gang width of %d\n", name, programCount); break;
 		}
 	}
 }
@@ -122,18 +190,20 @@ static void dot_CPP_Serial(picobench::state& s)
 
 	InitializeAoS(vec, s.iterations());
 
-	s.start_timer();
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
 
 	#pragma loop(no_vector)
-	for (int i = 0; i < s.iterations(); ++i)
+	for (int i = 0; i < repetitions; ++i)
 	{
 		DotProductCpp(output, vec, s.iterations());
 		s.set_result((uintptr_t)&output);
 	}
 
-	s.stop_timer(); // Manual stop
+	Bench::StopTimer(s); // Manual stop
 }
-PICOBENCH(dot_CPP_Serial);
+PICOBENCH_THROUGHPUT(dot_CPP_Serial, 16);
 
 static void dot_CPP_vhaddps(picobench::state& s)
 {
@@ -145,18 +215,20 @@ static void dot_CPP_vhaddps(picobench::state& s)
 
 	InitializeAoS_SSE(vec, s.iterations());
 
-	s.start_timer();
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
 
 	#pragma loop(no_vector)
-	for (int i = 0; i < s.iterations(); ++i)
+	for (int i = 0; i < repetitions; ++i)
 	{
 		Types::DotProduct_HADD(output, vec.data(), s.iterations());
 		s.set_result((uintptr_t)&output);
 	}
 
-	s.stop_timer(); // Manual stop
+	Bench::StopTimer(s); // Manual stop
 }
-PICOBENCH(dot_CPP_vhaddps);
+PICOBENCH_THROUGHPUT(dot_CPP_vhaddps, 20);
 
 static void dot_CPP_vddps(picobench::state& s)
 {
@@ -168,18 +240,20 @@ static void dot_CPP_vddps(picobench::state& s)
 
 	InitializeAoS_SSE(vec, s.iterations());
 
-	s.start_timer();
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
 
 	#pragma loop(no_vector)
-	for (int i = 0; i < s.iterations(); ++i)
+	for (int i = 0; i < repetitions; ++i)
 	{
 		Types::DotProduct_DPPS(output, vec.data(), s.iterations());
 		s.set_result((uintptr_t)&output);
 	}
 
-	s.stop_timer(); // Manual stop
+	Bench::StopTimer(s); // Manual stop
 }
-PICOBENCH(dot_CPP_vddps);
+PICOBENCH_THROUGHPUT(dot_CPP_vddps, 20);
 
 static void dot_CPP_vmul_shuffle_add(picobench::state& s)
 {
@@ -191,18 +265,20 @@ static void dot_CPP_vmul_shuffle_add(picobench::state& s)
 
 	InitializeAoS_SSE(vec, s.iterations());
 
-	s.start_timer();
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
 
 	#pragma loop(no_vector)
-	for (int i = 0; i < s.iterations(); ++i)
+	for (int i = 0; i < repetitions; ++i)
 	{
 		Types::DotProduct_SHUFFLE(output, vec.data(), s.iterations());
 		s.set_result((uintptr_t)&output);
 	}
 
-	s.stop_timer(); // Manual stop
+	Bench::StopTimer(s); // Manual stop
 }
-PICOBENCH(dot_CPP_vmul_shuffle_add);
+PICOBENCH_THROUGHPUT(dot_CPP_vmul_shuffle_add, 20);
 
 
 static void dot_ispc_AoS(picobench::state& s)
@@ -215,18 +291,22 @@ static void dot_ispc_AoS(picobench::state& s)
 
 	InitializeAoS(vec, s.iterations());
 
-	s.start_timer();
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
 
 	#pragma loop(no_vector)
-	for (int i = 0; i < s.iterations(); ++i)
+	for (int i = 0; i < repetitions; ++i)
 	{
-		ispc::DotProductAoS(output.data(), (ispc::Vector3*) vec.data(), s.iterations());
+		ISPC_KERNEL(DotProductAoS)(output.data(), (ispc::Vector3*) vec.data(), s.iterations());
 		s.set_result((uintptr_t)&output);
 	}
 
-	s.stop_timer(); // Manual stop
+	Bench::StopTimer(s); // Manual stop
+
+	VerifyDotProduct("dot_ispc_AoS", output, s.iterations());
 }
-PICOBENCH(dot_ispc_AoS);
+PICOBENCH_THROUGHPUT(dot_ispc_AoS, 16);
 
 static void dot_ispc_SoA(picobench::state& s)
 {
@@ -241,36 +321,1010 @@ static void dot_ispc_SoA(picobench::state& s)
 	z.reserve(s.iterations());
 
 	InitializeSoA(x, y, z, s.iterations());
-	s.start_timer();
+
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
 
 	#pragma loop(no_vector)
-	for (int i = 0; i < s.iterations(); ++i)
+	for (int i = 0; i < repetitions; ++i)
 	{
-		ispc::DotProductSoA(output.data(), x.data(), y.data(), z.data(), s.iterations());
+		ISPC_KERNEL(DotProductSoA)(output.data(), x.data(), y.data(), z.data(), s.iterations());
 		s.set_result((uintptr_t)&output);
 	}
 
-	s.stop_timer(); // Manual stop
+	Bench::StopTimer(s); // Manual stop
+
+	VerifyDotProduct("dot_ispc_SoA", output, s.iterations());
 }
-PICOBENCH(dot_ispc_SoA);
+PICOBENCH_THROUGHPUT(dot_ispc_SoA, 16);
 
-static void dot_ispc_AoSoA(picobench::state& s)
+template <size_t Width>
+static void dot_ispc_AoSoA_Width(picobench::state& s)
 {
 	vector<float> output(0.0f, s.iterations());
-	vector<float> vec;
+	Types::AoSoA<Vector3, Width> vec;
 
 	output.resize(s.iterations());
 
 	InitializeAoSoA(vec, s.iterations());
-	s.start_timer();
+
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
+
+	#pragma loop(no_vector)
+	for (int i = 0; i < repetitions; ++i)
+	{
+		ISPC_KERNEL(DotProductAoSoA)(output.data(), vec.Data(), s.iterations());
+		s.set_result((uintptr_t)&output);
+	}
+
+	Bench::StopTimer(s); // Manual stop
+
+	VerifyDotProduct("dot_ispc_AoSoA", output, s.iterations());
+}
+
+static void dot_ispc_AoSoA(picobench::state& s)
+{
+	WithAoSoAWidth("dot_ispc_AoSoA", [&]<size_t Width>() { dot_ispc_AoSoA_Width<Width>(s); });
+}
+PICOBENCH_THROUGHPUT(dot_ispc_AoSoA, 16);
+
+
+// Intrinsic baselines at the AVX2 and AVX-512 gang widths, see vector3.h
+
+static void dot_CPP_AVX2_AoS(picobench::state& s)
+{
+	vector<float> output(s.iterations());
+	vector<Vector3> vec;
+
+	InitializeAoS(vec, s.iterations());
+
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
+
+	#pragma loop(no_vector)
+	for (int i = 0; i < repetitions; ++i)
+	{
+		Types::DotProduct_AVX2_AoS(output, vec.data(), s.iterations());
+		s.set_result((uintptr_t)&output);
+	}
+
+	Bench::StopTimer(s); // Manual stop
+
+	VerifyDotProduct("dot_CPP_AVX2_AoS", output, s.iterations());
+}
+PICOBENCH_THROUGHPUT(dot_CPP_AVX2_AoS, 16);
+
+static void dot_CPP_AVX2_SoA(picobench::state& s)
+{
+	vector<float> output(s.iterations());
+	vector<float> x;
+	vector<float> y;
+	vector<float> z;
+
+	InitializeSoA(x, y, z, s.iterations());
+
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
+
+	#pragma loop(no_vector)
+	for (int i = 0; i < repetitions; ++i)
+	{
+		Types::DotProduct_AVX2_SoA(output, x.data(), y.data(), z.data(), s.iterations());
+		s.set_result((uintptr_t)&output);
+	}
+
+	Bench::StopTimer(s); // Manual stop
+
+	VerifyDotProduct("dot_CPP_AVX2_SoA", output, s.iterations());
+}
+PICOBENCH_THROUGHPUT(dot_CPP_AVX2_SoA, 16);
+
+static void dot_CPP_AVX2_AoSoA(picobench::state& s)
+{
+	vector<float> output(s.iterations());
+	Types::AoSoA<Vector3, 8> vec;
+	vector<Vector3> src;
+
+	// the ISPC fill writes blocks of the target's gang width, so build these from AoS
+	InitializeAoS(src, s.iterations());
+	vec.Assign(src.data(), s.iterations());
+
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
+
+	#pragma loop(no_vector)
+	for (int i = 0; i < repetitions; ++i)
+	{
+		Types::DotProduct_AVX2_AoSoA(output, vec, s.iterations());
+		s.set_result((uintptr_t)&output);
+	}
+
+	Bench::StopTimer(s); // Manual stop
+
+	VerifyDotProduct("dot_CPP_AVX2_AoSoA", output, s.iterations());
+}
+PICOBENCH_THROUGHPUT(dot_CPP_AVX2_AoSoA, 16);
+
+static void dot_CPP_AVX512_AoS(picobench::state& s)
+{
+	if (!HostSupportsAVX512("dot_CPP_AVX512_AoS"))
+	{
+		return;
+	}
+
+	vector<float> output(s.iterations());
+	vector<Vector3> vec;
+
+	InitializeAoS(vec, s.iterations());
+
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
+
+	#pragma loop(no_vector)
+	for (int i = 0; i < repetitions; ++i)
+	{
+		Types::DotProduct_AVX512_AoS(output, vec.data(), s.iterations());
+		s.set_result((uintptr_t)&output);
+	}
+
+	Bench::StopTimer(s); // Manual stop
+
+	VerifyDotProduct("dot_CPP_AVX512_AoS", output, s.iterations());
+}
+PICOBENCH_THROUGHPUT(dot_CPP_AVX512_AoS, 16);
+
+static void dot_CPP_AVX512_SoA(picobench::state& s)
+{
+	if (!HostSupportsAVX512("dot_CPP_AVX512_SoA"))
+	{
+		return;
+	}
+
+	vector<float> output(s.iterations());
+	vector<float> x;
+	vector<float> y;
+	vector<float> z;
+
+	InitializeSoA(x, y, z, s.iterations());
+
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
+
+	#pragma loop(no_vector)
+	for (int i = 0; i < repetitions; ++i)
+	{
+		Types::DotProduct_AVX512_SoA(output, x.data(), y.data(), z.data(), s.iterations());
+		s.set_result((uintptr_t)&output);
+	}
+
+	Bench::StopTimer(s); // Manual stop
+
+	VerifyDotProduct("dot_CPP_AVX512_SoA", output, s.iterations());
+}
+PICOBENCH_THROUGHPUT(dot_CPP_AVX512_SoA, 16);
+
+static void dot_CPP_AVX512_AoSoA(picobench::state& s)
+{
+	if (!HostSupportsAVX512("dot_CPP_AVX512_AoSoA"))
+	{
+		return;
+	}
+
+	vector<float> output(s.iterations());
+	Types::AoSoA<Vector3, 16> vec;
+	vector<Vector3> src;
+
+	// the ISPC fill writes blocks of the target's gang width, so build these from AoS
+	InitializeAoS(src, s.iterations());
+	vec.Assign(src.data(), s.iterations());
+
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
+
+	#pragma loop(no_vector)
+	for (int i = 0; i < repetitions; ++i)
+	{
+		Types::DotProduct_AVX512_AoSoA(output, vec, s.iterations());
+		s.set_result((uintptr_t)&output);
+	}
+
+	Bench::StopTimer(s); // Manual stop
+
+	VerifyDotProduct("dot_CPP_AVX512_AoSoA", output, s.iterations());
+}
+PICOBENCH_THROUGHPUT(dot_CPP_AVX512_AoSoA, 16);
+
+
+// Layout transposition, every repetition converts the whole array (12 bytes read + 12 written per element)
+
+namespace
+{
+	typedef decltype(&ispc::AoSToSoA) AoSToSoAKernel;
+	typedef decltype(&ispc::SoAToAoS) SoAToAoSKernel;
+	typedef decltype(&ispc::AoSToAoSoA) AoSToAoSoAKernel;
+	typedef decltype(&ispc::AoSoAToAoS) AoSoAToAoSKernel;
+	typedef decltype(&ispc::SoAToAoSoA) SoAToAoSoAKernel;
+	typedef decltype(&ispc::AoSoAToSoA) AoSoAToSoAKernel;
+
+	// the conversions only move floats, so the output has to match the initializer of its layout exactly
+	bool VerifyLayout(const char* name, const float* output, const float* expected, const size_t count)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (output[i] != expected[i])
+			{
+				fprintf(stderr, "%s: mismatch at %zu (%f != %f)\n", name, i, output[i], expected[i]);
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void TransposeAoSToSoA(picobench::state& s, const char* name, AoSToSoAKernel kernel)
+	{
+		// value-initialized, so the output pages are touched before the timer starts
+		vector<float> x(s.iterations());
+		vector<float> y(s.iterations());
+		vector<float> z(s.iterations());
+		vector<Vector3> vec;
+
+		InitializeAoS(vec, s.iterations());
+
+		const int repetitions = Bench::Repetitions(s);
+
+		Bench::StartTimer(s);
+
+		#pragma loop(no_vector)
+		for (int i = 0; i < repetitions; ++i)
+		{
+			kernel((ispc::Vector3*) vec.data(), x.data(), y.data(), z.data(), s.iterations());
+			s.set_result((uintptr_t)&x);
+		}
+
+		Bench::StopTimer(s); // Manual stop
+
+		vector<float> ex, ey, ez;
+		InitializeSoA(ex, ey, ez, s.iterations());
+		VerifyLayout(name, x.data(), ex.data(), s.iterations());
+		VerifyLayout(name, y.data(), ey.data(), s.iterations());
+		VerifyLayout(name, z.data(), ez.data(), s.iterations());
+	}
+
+	void TransposeSoAToAoS(picobench::state& s, const char* name, SoAToAoSKernel kernel)
+	{
+		vector<Vector3> vec(s.iterations());
+		vector<float> x;
+		vector<float> y;
+		vector<float> z;
+
+		InitializeSoA(x, y, z, s.iterations());
+
+		const int repetitions = Bench::Repetitions(s);
+
+		Bench::StartTimer(s);
+
+		#pragma loop(no_vector)
+		for (int i = 0; i < repetitions; ++i)
+		{
+			kernel(x.data(), y.data(), z.data(), (ispc::Vector3*) vec.data(), s.iterations());
+			s.set_result((uintptr_t)&vec);
+		}
+
+		Bench::StopTimer(s); // Manual stop
+
+		vector<Vector3> expected;
+		InitializeAoS(expected, s.iterations());
+		VerifyLayout(name, &vec[0].x, &expected[0].x, s.iterations() * 3);
+	}
+
+	template <size_t Width>
+	void TransposeAoSToAoSoA(picobench::state& s, const char* name, AoSToAoSoAKernel kernel)
+	{
+		Types::AoSoA<Vector3, Width> vec;
+		vector<Vector3> src;
+
+		vec.Resize(s.iterations());
+		InitializeAoS(src, s.iterations());
+
+		const int repetitions = Bench::Repetitions(s);
+
+		Bench::StartTimer(s);
+
+		#pragma loop(no_vector)
+		for (int i = 0; i < repetitions; ++i)
+		{
+			kernel((ispc::Vector3*) src.data(), vec.Data(), s.iterations());
+			s.set_result((uintptr_t)vec.Data());
+		}
+
+		Bench::StopTimer(s); // Manual stop
+
+		Types::AoSoA<Vector3, Width> expected;
+		InitializeAoSoA(expected, s.iterations());
+		VerifyLayout(name, vec.Data(), expected.Data(), expected.ScalarCount());
+	}
+
+	template <size_t Width>
+	void TransposeAoSoAToAoS(picobench::state& s, const char* name, AoSoAToAoSKernel kernel)
+	{
+		vector<Vector3> vec(s.iterations());
+		Types::AoSoA<Vector3, Width> src;
+
+		InitializeAoSoA(src, s.iterations());
+
+		const int repetitions = Bench::Repetitions(s);
+
+		Bench::StartTimer(s);
+
+		#pragma loop(no_vector)
+		for (int i = 0; i < repetitions; ++i)
+		{
+			kernel(src.Data(), (ispc::Vector3*) vec.data(), s.iterations());
+			s.set_result((uintptr_t)&vec);
+		}
+
+		Bench::StopTimer(s); // Manual stop
+
+		vector<Vector3> expected;
+		InitializeAoS(expected, s.iterations());
+		VerifyLayout(name, &vec[0].x, &expected[0].x, s.iterations() * 3);
+	}
+
+	template <size_t Width>
+	void TransposeSoAToAoSoA(picobench::state& s, const char* name, SoAToAoSoAKernel kernel)
+	{
+		Types::AoSoA<Vector3, Width> vec;
+		vector<float> x;
+		vector<float> y;
+		vector<float> z;
+
+		vec.Resize(s.iterations());
+		InitializeSoA(x, y, z, s.iterations());
+
+		const int repetitions = Bench::Repetitions(s);
+
+		Bench::StartTimer(s);
+
+		#pragma loop(no_vector)
+		for (int i = 0; i < repetitions; ++i)
+		{
+			kernel(x.data(), y.data(), z.data(), vec.Data(), s.iterations());
+			s.set_result((uintptr_t)vec.Data());
+		}
+
+		Bench::StopTimer(s); // Manual stop
+
+		Types::AoSoA<Vector3, Width> expected;
+		InitializeAoSoA(expected, s.iterations());
+		VerifyLayout(name, vec.Data(), expected.Data(), expected.ScalarCount());
+	}
+
+	template <size_t Width>
+	void TransposeAoSoAToSoA(picobench::state& s, const char* name, AoSoAToSoAKernel kernel)
+	{
+		vector<float> x(s.iterations());
+		vector<float> y(s.iterations());
+		vector<float> z(s.iterations());
+		Types::AoSoA<Vector3, Width> src;
+
+		InitializeAoSoA(src, s.iterations());
+
+		const int repetitions = Bench::Repetitions(s);
+
+		Bench::StartTimer(s);
+
+		#pragma loop(no_vector)
+		for (int i = 0; i < repetitions; ++i)
+		{
+			kernel(src.Data(), x.data(), y.data(), z.data(), s.iterations());
+			s.set_result((uintptr_t)&x);
+		}
+
+		Bench::StopTimer(s); // Manual stop
+
+		vector<float> ex, ey, ez;
+		InitializeSoA(ex, ey, ez, s.iterations());
+		VerifyLayout(name, x.data(), ex.data(), s.iterations());
+		VerifyLayout(name, y.data(), ey.data(), s.iterations());
+		VerifyLayout(name, z.data(), ez.data(), s.iterations());
+	}
+}
+
+PICOBENCH_SUITE("Transpose");
+
+static void transpose_ispc_AoS_to_SoA(picobench::state& s)
+{
+	TransposeAoSToSoA(s, "transpose_ispc_AoS_to_SoA", ISPC_KERNEL(AoSToSoA));
+}
+PICOBENCH_THROUGHPUT(transpose_ispc_AoS_to_SoA, 24);
+
+static void transpose_ispc_AoS_to_SoA_Tasks(picobench::state& s)
+{
+	TaskSys::SetThreadCount(static_cast<int>(s.user_data()));
+	TransposeAoSToSoA(s, "transpose_ispc_AoS_to_SoA_Tasks", ISPC_KERNEL(AoSToSoA_Tasks));
+}
+PICOBENCH_THREAD_SWEEP(transpose_ispc_AoS_to_SoA_Tasks, 24);
+
+static void transpose_ispc_SoA_to_AoS(picobench::state& s)
+{
+	TransposeSoAToAoS(s, "transpose_ispc_SoA_to_AoS", ISPC_KERNEL(SoAToAoS));
+}
+PICOBENCH_THROUGHPUT(transpose_ispc_SoA_to_AoS, 24);
+
+static void transpose_ispc_SoA_to_AoS_Tasks(picobench::state& s)
+{
+	TaskSys::SetThreadCount(static_cast<int>(s.user_data()));
+	TransposeSoAToAoS(s, "transpose_ispc_SoA_to_AoS_Tasks", ISPC_KERNEL(SoAToAoS_Tasks));
+}
+PICOBENCH_THREAD_SWEEP(transpose_ispc_SoA_to_AoS_Tasks, 24);
+
+static void transpose_ispc_AoS_to_AoSoA(picobench::state& s)
+{
+	WithAoSoAWidth("transpose_ispc_AoS_to_AoSoA", [&]<size_t Width>() { TransposeAoSToAoSoA<Width>(s, "transpose_ispc_AoS_to_AoSoA", ISPC_KERNEL(AoSToAoSoA)); });
+}
+PICOBENCH_THROUGHPUT(transpose_ispc_AoS_to_AoSoA, 24);
+
+static void transpose_ispc_AoS_to_AoSoA_Tasks(picobench::state& s)
+{
+	TaskSys::SetThreadCount(static_cast<int>(s.user_data()));
+	WithAoSoAWidth("transpose_ispc_AoS_to_AoSoA_Tasks", [&]<size_t Width>() { TransposeAoSToAoSoA<Width>(s, "transpose_ispc_AoS_to_AoSoA_Tasks", ISPC_KERNEL(AoSToAoSoA_Tasks)); });
+}
+PICOBENCH_THREAD_SWEEP(transpose_ispc_AoS_to_AoSoA_Tasks, 24);
+
+static void transpose_ispc_AoSoA_to_AoS(picobench::state& s)
+{
+	WithAoSoAWidth("transpose_ispc_AoSoA_to_AoS", [&]<size_t Width>() { TransposeAoSoAToAoS<Width>(s, "transpose_ispc_AoSoA_to_AoS", ISPC_KERNEL(AoSoAToAoS)); });
+}
+PICOBENCH_THROUGHPUT(transpose_ispc_AoSoA_to_AoS, 24);
+
+static void transpose_ispc_AoSoA_to_AoS_Tasks(picobench::state& s)
+{
+	TaskSys::SetThreadCount(static_cast<int>(s.user_data()));
+	WithAoSoAWidth("transpose_ispc_AoSoA_to_AoS_Tasks", [&]<size_t Width>() { TransposeAoSoAToAoS<Width>(s, "transpose_ispc_AoSoA_to_AoS_Tasks", ISPC_KERNEL(AoSoAToAoS_Tasks)); });
+}
+PICOBENCH_THREAD_SWEEP(transpose_ispc_AoSoA_to_AoS_Tasks, 24);
+
+static void transpose_ispc_SoA_to_AoSoA(picobench::state& s)
+{
+	WithAoSoAWidth("transpose_ispc_SoA_to_AoSoA", [&]<size_t Width>() { TransposeSoAToAoSoA<Width>(s, "transpose_ispc_SoA_to_AoSoA", ISPC_KERNEL(SoAToAoSoA)); });
+}
+PICOBENCH_THROUGHPUT(transpose_ispc_SoA_to_AoSoA, 24);
+
+static void transpose_ispc_SoA_to_AoSoA_Tasks(picobench::state& s)
+{
+	TaskSys::SetThreadCount(static_cast<int>(s.user_data()));
+	WithAoSoAWidth("transpose_ispc_SoA_to_AoSoA_Tasks", [&]<size_t Width>() { TransposeSoAToAoSoA<Width>(s, "transpose_ispc_SoA_to_AoSoA_Tasks", ISPC_KERNEL(SoAToAoSoA_Tasks)); });
+}
+PICOBENCH_THREAD_SWEEP(transpose_ispc_SoA_to_AoSoA_Tasks, 24);
+
+static void transpose_ispc_AoSoA_to_SoA(picobench::state& s)
+{
+	WithAoSoAWidth("transpose_ispc_AoSoA_to_SoA", [&]<size_t Width>() { TransposeAoSoAToSoA<Width>(s, "transpose_ispc_AoSoA_to_SoA", ISPC_KERNEL(AoSoAToSoA)); });
+}
+PICOBENCH_THROUGHPUT(transpose_ispc_AoSoA_to_SoA, 24);
+
+static void transpose_ispc_AoSoA_to_SoA_Tasks(picobench::state& s)
+{
+	TaskSys::SetThreadCount(static_cast<int>(s.user_data()));
+	WithAoSoAWidth("transpose_ispc_AoSoA_to_SoA_Tasks", [&]<size_t Width>() { TransposeAoSoAToSoA<Width>(s, "transpose_ispc_AoSoA_to_SoA_Tasks", ISPC_KERNEL(AoSoAToSoA_Tasks)); });
+}
+PICOBENCH_THREAD_SWEEP(transpose_ispc_AoSoA_to_SoA_Tasks, 24);
+
+
+// Converting AoS data once and then running the SoA / AoSoA kernels against running DotProductAoS in place.
+// Every repetition pays for the conversion, so this is the case where the converted data is only used once,
+// the Transpose suite and dot_ispc_SoA / dot_ispc_AoSoA give the cost per pass when it's reused.
+
+PICOBENCH_SUITE("AoS_vs_Convert");
+
+static void dot_ispc_AoS_InPlace(picobench::state& s)
+{
+	vector<float> output(s.iterations());
+	vector<Vector3> vec;
+
+	InitializeAoS(vec, s.iterations());
+
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
+
+	#pragma loop(no_vector)
+	for (int i = 0; i < repetitions; ++i)
+	{
+		ISPC_KERNEL(DotProductAoS)(output.data(), (ispc::Vector3*) vec.data(), s.iterations());
+		s.set_result((uintptr_t)&output);
+	}
+
+	Bench::StopTimer(s); // Manual stop
+
+	VerifyDotProduct("dot_ispc_AoS_InPlace", output, s.iterations());
+}
+PICOBENCH_THROUGHPUT(dot_ispc_AoS_InPlace, 16);
+
+static void dot_ispc_AoS_Convert_SoA(picobench::state& s)
+{
+	vector<float> output(s.iterations());
+	vector<float> x(s.iterations());
+	vector<float> y(s.iterations());
+	vector<float> z(s.iterations());
+	vector<Vector3> vec;
+
+	InitializeAoS(vec, s.iterations());
+
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
+
+	#pragma loop(no_vector)
+	for (int i = 0; i < repetitions; ++i)
+	{
+		ISPC_KERNEL(AoSToSoA)((ispc::Vector3*) vec.data(), x.data(), y.data(), z.data(), s.iterations());
+		ISPC_KERNEL(DotProductSoA)(output.data(), x.data(), y.data(), z.data(), s.iterations());
+		s.set_result((uintptr_t)&output);
+	}
+
+	Bench::StopTimer(s); // Manual stop
+
+	VerifyDotProduct("dot_ispc_AoS_Convert_SoA", output, s.iterations());
+}
+PICOBENCH_THROUGHPUT(dot_ispc_AoS_Convert_SoA, 16);
+
+template <size_t Width>
+static void dot_ispc_AoS_Convert_AoSoA_Width(picobench::state& s)
+{
+	vector<float> output(s.iterations());
+	Types::AoSoA<Vector3, Width> soa;
+	vector<Vector3> vec;
+
+	soa.Resize(s.iterations());
+	InitializeAoS(vec, s.iterations());
+
+	const int repetitions = Bench::Repetitions(s);
+
+	Bench::StartTimer(s);
 
 	#pragma loop(no_vector)
-	for (int i = 0; i < s.iterations(); ++i)
+	for (int i = 0; i < repetitions; ++i)
 	{
-		ispc::DotProductAoSoA(output.data(), vec.data(), s.iterations());
+		ISPC_KERNEL(AoSToAoSoA)((ispc::Vector3*) vec.data(), soa.Data(), s.iterations());
+		ISPC_KERNEL(DotProductAoSoA)(output.data(), soa.Data(), s.iterations());
 		s.set_result((uintptr_t)&output);
 	}
 
-	s.stop_timer(); // Manual stop
+	Bench::StopTimer(s); // Manual stop
+
+	VerifyDotProduct("dot_ispc_AoS_Convert_AoSoA", output, s.iterations());
+}
+
+static void dot_ispc_AoS_Convert_AoSoA(picobench::state& s)
+{
+	WithAoSoAWidth("dot_ispc_AoS_Convert_AoSoA", [&]<size_t Width>() { dot_ispc_AoS_Convert_AoSoA_Width<Width>(s); });
+}
+PICOBENCH_THROUGHPUT(dot_ispc_AoS_Convert_AoSoA, 16);
+
+
+// Batched Vector3 math, each kernel on AoS, SoA and AoSoA data against its C++ reference.
+// The inputs hold the same values in every layout, so every output is checked against the reference on AoS data.
+
+namespace
+{
+	static constexpr uint32_t RAND_SEED_B = 0x5EED5EED;
+	static constexpr float LERP_T = 0.25f;
+
+	// rotation about z, a non-uniform scale and a translation
+	static constexpr float MATRIX_3X4[12] =
+	{
+		0.8f, -1.2f, 0.0f, 1.0f,
+		0.6f, 1.6f, 0.0f, -2.0f,
+		0.0f, 0.0f, 0.5f, 3.0f,
+	};
+
+	// a perspective projection, w = z + 2 stays well away from zero for inputs in [0, 1)
+	static constexpr float MATRIX_4X4[16] =
+	{
+		1.5f, 0.0f, 0.0f, 0.0f,
+		0.0f, 2.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, -1.0f, -0.2f,
+		0.0f, 0.0f, 1.0f, 2.0f,
+	};
+
+	// inputs a and b and a Vector3 output in one layout, A(), B() and Output() are what the ISPC kernels take
+	struct AoSData
+	{
+		vector<Vector3> a, b, output;
+
+		void Initialize(const size_t count)
+		{
+			InitializeAoS(a, count);
+			InitializeAoS(b, count, RAND_SEED_B);
+			output.resize(count);
+		}
+
+		ispc::Vector3* A() { return (ispc::Vector3*) a.data(); }
+		ispc::Vector3* B() { return (ispc::Vector3*) b.data(); }
+		ispc::Vector3* Output() { return (ispc::Vector3*) output.data(); }
+		Vector3 At(const size_t i) const { return output[i]; }
+	};
+
+	struct SoAData
+	{
+		vector<float> ax, ay, az;
+		vector<float> bx, by, bz;
+		vector<float> x, y, z;
+
+		void Initialize(const size_t count)
+		{
+			InitializeSoA(ax, ay, az, count);
+			InitializeSoA(bx, by, bz, count, RAND_SEED_B);
+			x.resize(count);
+			y.resize(count);
+			z.resize(count);
+		}
+
+		ispc::Vector3SoA A() { return { ax.data(), ay.data(), az.data() }; }
+		ispc::Vector3SoA B() { return { bx.data(), by.data(), bz.data() }; }
+		ispc::Vector3SoA Output() { return { x.data(), y.data(), z.data() }; }
+		Vector3 At(const size_t i) const { return { x[i], y[i], z[i] }; }
+	};
+
+	template <size_t Width>
+	struct AoSoAData
+	{
+		Types::AoSoA<Vector3, Width> a, b, output;
+
+		void Initialize(const size_t count)
+		{
+			InitializeAoSoA(a, count);
+			InitializeAoSoA(b, count, RAND_SEED_B);
+			output.Resize(count);
+		}
+
+		float* A() { return a.Data(); }
+		float* B() { return b.Data(); }
+		float* Output() { return output.Data(); }
+		Vector3 At(const size_t i) const { return output.Get(i); }
+	};
+
+	bool Matches(const float output, const float expected)
+	{
+		return std::fabs(output - expected) <= 1e-5f * std::max(1.f, std::fabs(expected));
+	}
+
+	// kernel(data, output, count) writes one float per element, reference(aos, output, count) is the C++ version
+	template <typename Data, typename Kernel, typename Reference>
+	void BatchedFloat(picobench::state& s, const char* name, Kernel&& kernel, Reference&& reference)
+	{
+		vector<float> output(s.iterations());
+		Data data;
+
+		data.Initialize(s.iterations());
+
+		const int repetitions = Bench::Repetitions(s);
+
+		Bench::StartTimer(s);
+
+		#pragma loop(no_vector)
+		for (int i = 0; i < repetitions; ++i)
+		{
+			kernel(data, output, s.iterations());
+			s.set_result((uintptr_t)&output);
+		}
+
+		Bench::StopTimer(s); // Manual stop
+
+		AoSData input;
+		vector<float> expected(s.iterations());
+
+		input.Initialize(s.iterations());
+		reference(input, expected, s.iterations());
+
+		for (int i = 0; i < s.iterations(); ++i)
+		{
+			if (!Matches(output[i], expected[i]))
+			{
+				fprintf(stderr, "%s: mismatch at %d (%f != %f)\n", name, i, output[i], expected[i]);
+				return;
+			}
+		}
+	}
+
+	// kernel(data, count) writes data's Vector3 output, reference(aos, count) is the C++ version
+	template <typename Data, typename Kernel, typename Reference>
+	void BatchedVector3(picobench::state& s, const char* name, Kernel&& kernel, Reference&& reference)
+	{
+		Data data;
+
+		data.Initialize(s.iterations());
+
+		const int repetitions = Bench::Repetitions(s);
+
+		Bench::StartTimer(s);
+
+		#pragma loop(no_vector)
+		for (int i = 0; i < repetitions; ++i)
+		{
+			kernel(data, s.iterations());
+			s.set_result((uintptr_t)&data);
+		}
+
+		Bench::StopTimer(s); // Manual stop
+
+		AoSData expected;
+
+		expected.Initialize(s.iterations());
+		reference(expected, s.iterations());
+
+		for (int i = 0; i < s.iterations(); ++i)
+		{
+			const Vector3 v = data.At(i);
+			const Vector3 e = expected.output[i];
+
+			if (!Matches(v.x, e.x) || !Matches(v.y, e.y) || !Matches(v.z, e.z))
+			{
+				fprintf(stderr, "%s: mismatch at %d ((%f, %f, %f) != (%f, %f, %f))\n", name, i, v.x, v.y, v.z, e.x, e.y, e.z);
+				return;
+			}
+		}
+	}
+
+	void Dot2Reference(AoSData& d, vector<float>& output, const size_t count)
+	{
+		DotCpp(output, d.a, d.b, count);
+	}
+	void CrossReference(AoSData& d, const size_t count)
+	{
+		CrossCpp(d.output, d.a, d.b, count);
+	}
+	void LengthReference(AoSData& d, vector<float>& output, const size_t count)
+	{
+		LengthCpp(output, d.a, count);
+	}
+	void NormalizeReference(AoSData& d, const size_t count)
+	{
+		NormalizeCpp(d.output, d.a, count);
+	}
+	void LerpReference(AoSData& d, const size_t count)
+	{
+		LerpCpp(d.output, d.a, d.b, LERP_T, count);
+	}
+	void TransformPoints3x4Reference(AoSData& d, const size_t count)
+	{
+		TransformPoints3x4Cpp(d.output, d.a, MATRIX_3X4, count);
+	}
+	void TransformPoints4x4Reference(AoSData& d, const size_t count)
+	{
+		TransformPoints4x4Cpp(d.output, d.a, MATRIX_4X4, count);
+	}
+	void TransformNormalsReference(AoSData& d, const size_t count)
+	{
+		TransformNormalsCpp(d.output, d.a, MATRIX_3X4, count);
+	}
+}
+
+PICOBENCH_SUITE("Dot2");
+
+static void dot2_CPP(picobench::state& s)
+{
+	BatchedFloat<AoSData>(s, "dot2_CPP", Dot2Reference, Dot2Reference);
+}
+PICOBENCH_THROUGHPUT(dot2_CPP, 28);
+
+static void dot2_ispc_AoS(picobench::state& s)
+{
+	BatchedFloat<AoSData>(s, "dot2_ispc_AoS", [](auto& d, vector<float>& output, const size_t count) { ISPC_KERNEL(DotAoS)(output.data(), d.A(), d.B(), count); }, Dot2Reference);
+}
+PICOBENCH_THROUGHPUT(dot2_ispc_AoS, 28);
+
+static void dot2_ispc_SoA(picobench::state& s)
+{
+	BatchedFloat<SoAData>(s, "dot2_ispc_SoA", [](auto& d, vector<float>& output, const size_t count) { ISPC_KERNEL(DotSoA)(output.data(), d.A(), d.B(), count); }, Dot2Reference);
+}
+PICOBENCH_THROUGHPUT(dot2_ispc_SoA, 28);
+
+static void dot2_ispc_AoSoA(picobench::state& s)
+{
+	WithAoSoAWidth("dot2_ispc_AoSoA", [&]<size_t Width>() { BatchedFloat<AoSoAData<Width>>(s, "dot2_ispc_AoSoA", [](auto& d, vector<float>& output, const size_t count) { ISPC_KERNEL(DotAoSoA)(output.data(), d.A(), d.B(), count); }, Dot2Reference); });
+}
+PICOBENCH_THROUGHPUT(dot2_ispc_AoSoA, 28);
+
+PICOBENCH_SUITE("Cross");
+
+static void cross_CPP(picobench::state& s)
+{
+	BatchedVector3<AoSData>(s, "cross_CPP", CrossReference, CrossReference);
+}
+PICOBENCH_THROUGHPUT(cross_CPP, 36);
+
+static void cross_ispc_AoS(picobench::state& s)
+{
+	BatchedVector3<AoSData>(s, "cross_ispc_AoS", [](auto& d, const size_t count) { ISPC_KERNEL(CrossAoS)(d.Output(), d.A(), d.B(), count); }, CrossReference);
+}
+PICOBENCH_THROUGHPUT(cross_ispc_AoS, 36);
+
+static void cross_ispc_SoA(picobench::state& s)
+{
+	BatchedVector3<SoAData>(s, "cross_ispc_SoA", [](auto& d, const size_t count) { ISPC_KERNEL(CrossSoA)(d.Output(), d.A(), d.B(), count); }, CrossReference);
+}
+PICOBENCH_THROUGHPUT(cross_ispc_SoA, 36);
+
+static void cross_ispc_AoSoA(picobench::state& s)
+{
+	WithAoSoAWidth("cross_ispc_AoSoA", [&]<size_t Width>() { BatchedVector3<AoSoAData<Width>>(s, "cross_ispc_AoSoA", [](auto& d, const size_t count) { ISPC_KERNEL(CrossAoSoA)(d.Output(), d.A(), d.B(), count); }, CrossReference); });
+}
+PICOBENCH_THROUGHPUT(cross_ispc_AoSoA, 36);
+
+PICOBENCH_SUITE("Length");
+
+static void length_CPP(picobench::state& s)
+{
+	BatchedFloat<AoSData>(s, "length_CPP", LengthReference, LengthReference);
+}
+PICOBENCH_THROUGHPUT(length_CPP, 16);
+
+static void length_ispc_AoS(picobench::state& s)
+{
+	BatchedFloat<AoSData>(s, "length_ispc_AoS", [](auto& d, vector<float>& output, const size_t count) { ISPC_KERNEL(LengthAoS)(output.data(), d.A(), count); }, LengthReference);
+}
+PICOBENCH_THROUGHPUT(length_ispc_AoS, 16);
+
+static void length_ispc_SoA(picobench::state& s)
+{
+	BatchedFloat<SoAData>(s, "length_ispc_SoA", [](auto& d, vector<float>& output, const size_t count) { ISPC_KERNEL(LengthSoA)(output.data(), d.A(), count); }, LengthReference);
+}
+PICOBENCH_THROUGHPUT(length_ispc_SoA, 16);
+
+static void length_ispc_AoSoA(picobench::state& s)
+{
+	WithAoSoAWidth("length_ispc_AoSoA", [&]<size_t Width>() { BatchedFloat<AoSoAData<Width>>(s, "length_ispc_AoSoA", [](auto& d, vector<float>& output, const size_t count) { ISPC_KERNEL(LengthAoSoA)(output.data(), d.A(), count); }, LengthReference); });
+}
+PICOBENCH_THROUGHPUT(length_ispc_AoSoA, 16);
+
+PICOBENCH_SUITE("Normalize");
+
+static void normalize_CPP(picobench::state& s)
+{
+	BatchedVector3<AoSData>(s, "normalize_CPP", NormalizeReference, NormalizeReference);
+}
+PICOBENCH_THROUGHPUT(normalize_CPP, 24);
+
+static void normalize_ispc_AoS(picobench::state& s)
+{
+	BatchedVector3<AoSData>(s, "normalize_ispc_AoS", [](auto& d, const size_t count) { ISPC_KERNEL(NormalizeAoS)(d.Output(), d.A(), count); }, NormalizeReference);
+}
+PICOBENCH_THROUGHPUT(normalize_ispc_AoS, 24);
+
+static void normalize_ispc_SoA(picobench::state& s)
+{
+	BatchedVector3<SoAData>(s, "normalize_ispc_SoA", [](auto& d, const size_t count) { ISPC_KERNEL(NormalizeSoA)(d.Output(), d.A(), count); }, NormalizeReference);
+}
+PICOBENCH_THROUGHPUT(normalize_ispc_SoA, 24);
+
+static void normalize_ispc_AoSoA(picobench::state& s)
+{
+	WithAoSoAWidth("normalize_ispc_AoSoA", [&]<size_t Width>() { BatchedVector3<AoSoAData<Width>>(s, "normalize_ispc_AoSoA", [](auto& d, const size_t count) { ISPC_KERNEL(NormalizeAoSoA)(d.Output(), d.A(), count); }, NormalizeReference); });
+}
+PICOBENCH_THROUGHPUT(normalize_ispc_AoSoA, 24);
+
+PICOBENCH_SUITE("Lerp");
+
+static void lerp_CPP(picobench::state& s)
+{
+	BatchedVector3<AoSData>(s, "lerp_CPP", LerpReference, LerpReference);
+}
+PICOBENCH_THROUGHPUT(lerp_CPP, 36);
+
+static void lerp_ispc_AoS(picobench::state& s)
+{
+	BatchedVector3<AoSData>(s, "lerp_ispc_AoS", [](auto& d, const size_t count) { ISPC_KERNEL(LerpAoS)(d.Output(), d.A(), d.B(), LERP_T, count); }, LerpReference);
+}
+PICOBENCH_THROUGHPUT(lerp_ispc_AoS, 36);
+
+static void lerp_ispc_SoA(picobench::state& s)
+{
+	BatchedVector3<SoAData>(s, "lerp_ispc_SoA", [](auto& d, const size_t count) { ISPC_KERNEL(LerpSoA)(d.Output(), d.A(), d.B(), LERP_T, count); }, LerpReference);
+}
+PICOBENCH_THROUGHPUT(lerp_ispc_SoA, 36);
+
+static void lerp_ispc_AoSoA(picobench::state& s)
+{
+	WithAoSoAWidth("lerp_ispc_AoSoA", [&]<size_t Width>() { BatchedVector3<AoSoAData<Width>>(s, "lerp_ispc_AoSoA", [](auto& d, const size_t count) { ISPC_KERNEL(LerpAoSoA)(d.Output(), d.A(), d.B(), LERP_T, count); }, LerpReference); });
+}
+PICOBENCH_THROUGHPUT(lerp_ispc_AoSoA, 36);
+
+PICOBENCH_SUITE("TransformPoints3x4");
+
+static void transform_points_3x4_CPP(picobench::state& s)
+{
+	BatchedVector3<AoSData>(s, "transform_points_3x4_CPP", TransformPoints3x4Reference, TransformPoints3x4Reference);
+}
+PICOBENCH_THROUGHPUT(transform_points_3x4_CPP, 24);
+
+static void transform_points_3x4_ispc_AoS(picobench::state& s)
+{
+	BatchedVector3<AoSData>(s, "transform_points_3x4_ispc_AoS", [](auto& d, const size_t count) { ISPC_KERNEL(TransformPoints3x4AoS)(d.Output(), d.A(), MATRIX_3X4, count); }, TransformPoints3x4Reference);
+}
+PICOBENCH_THROUGHPUT(transform_points_3x4_ispc_AoS, 24);
+
+static void transform_points_3x4_ispc_SoA(picobench::state& s)
+{
+	BatchedVector3<SoAData>(s, "transform_points_3x4_ispc_SoA", [](auto& d, const size_t count) { ISPC_KERNEL(TransformPoints3x4SoA)(d.Output(), d.A(), MATRIX_3X4, count); }, TransformPoints3x4Reference);
+}
+PICOBENCH_THROUGHPUT(transform_points_3x4_ispc_SoA, 24);
+
+static void transform_points_3x4_ispc_AoSoA(picobench::state& s)
+{
+	WithAoSoAWidth("transform_points_3x4_ispc_AoSoA", [&]<size_t Width>() { BatchedVector3<AoSoAData<Width>>(s, "transform_points_3x4_ispc_AoSoA", [](auto& d, const size_t count) { ISPC_KERNEL(TransformPoints3x4AoSoA)(d.Output(), d.A(), MATRIX_3X4, count); }, TransformPoints3x4Reference); });
+}
+PICOBENCH_THROUGHPUT(transform_points_3x4_ispc_AoSoA, 24);
+
+PICOBENCH_SUITE("TransformPoints4x4");
+
+static void transform_points_4x4_CPP(picobench::state& s)
+{
+	BatchedVector3<AoSData>(s, "transform_points_4x4_CPP", TransformPoints4x4Reference, TransformPoints4x4Reference);
+}
+PICOBENCH_THROUGHPUT(transform_points_4x4_CPP, 24);
+
+static void transform_points_4x4_ispc_AoS(picobench::state& s)
+{
+	BatchedVector3<AoSData>(s, "transform_points_4x4_ispc_AoS", [](auto& d, const size_t count) { ISPC_KERNEL(TransformPoints4x4AoS)(d.Output(), d.A(), MATRIX_4X4, count); }, TransformPoints4x4Reference);
+}
+PICOBENCH_THROUGHPUT(transform_points_4x4_ispc_AoS, 24);
+
+static void transform_points_4x4_ispc_SoA(picobench::state& s)
+{
+	BatchedVector3<SoAData>(s, "transform_points_4x4_ispc_SoA", [](auto& d, const size_t count) { ISPC_KERNEL(TransformPoints4x4SoA)(d.Output(), d.A(), MATRIX_4X4, count); }, TransformPoints4x4Reference);
+}
+PICOBENCH_THROUGHPUT(transform_points_4x4_ispc_SoA, 24);
+
+static void transform_points_4x4_ispc_AoSoA(picobench::state& s)
+{
+	WithAoSoAWidth("transform_points_4x4_ispc_AoSoA", [&]<size_t Width>() { BatchedVector3<AoSoAData<Width>>(s, "transform_points_4x4_ispc_AoSoA", [](auto& d, const size_t count) { ISPC_KERNEL(TransformPoints4x4AoSoA)(d.Output(), d.A(), MATRIX_4X4, count); }, TransformPoints4x4Reference); });
+}
+PICOBENCH_THROUGHPUT(transform_points_4x4_ispc_AoSoA, 24);
+
+PICOBENCH_SUITE("TransformNormals");
+
+static void transform_normals_CPP(picobench::state& s)
+{
+	BatchedVector3<AoSData>(s, "transform_normals_CPP", TransformNormalsReference, TransformNormalsReference);
+}
+PICOBENCH_THROUGHPUT(transform_normals_CPP, 24);
+
+static void transform_normals_ispc_AoS(picobench::state& s)
+{
+	BatchedVector3<AoSData>(s, "transform_normals_ispc_AoS", [](auto& d, const size_t count) { ISPC_KERNEL(TransformNormalsAoS)(d.Output(), d.A(), MATRIX_3X4, count); }, TransformNormalsReference);
+}
+PICOBENCH_THROUGHPUT(transform_normals_ispc_AoS, 24);
+
+static void transform_normals_ispc_SoA(picobench::state& s)
+{
+	BatchedVector3<SoAData>(s, "transform_normals_ispc_SoA", [](auto& d, const size_t count) { ISPC_KERNEL(TransformNormalsSoA)(d.Output(), d.A(), MATRIX_3X4, count); }, TransformNormalsReference);
+}
+PICOBENCH_THROUGHPUT(transform_normals_ispc_SoA, 24);
+
+static void transform_normals_ispc_AoSoA(picobench::state& s)
+{
+	WithAoSoAWidth("transform_normals_ispc_AoSoA", [&]<size_t Width>() { BatchedVector3<AoSoAData<Width>>(s, "transform_normals_ispc_AoSoA", [](auto& d, const size_t count) { ISPC_KERNEL(TransformNormalsAoSoA)(d.Output(), d.A(), MATRIX_3X4, count); }, TransformNormalsReference); });
+}
+PICOBENCH_THROUGHPUT(transform_normals_ispc_AoSoA, 24);
+
+
+int main(int argc, char* argv[])
+{
+	return Bench::Main(argc, argv, [](const int target)
+	{
+		const auto programCount = IspcTarget_GetProgramCount(target);
+		return programCount ? static_cast<int>(programCount()) : 0;
+	});
 }
-PICOBENCH(dot_ispc_AoSoA);
\ No newline at end of file
@@ -0,0 +1,637 @@
+// Copyright(c) 2024, Pete Brubaker <pete.brubaker@intel.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// ISPC: Making CPU SIMD fun while tracing rays!
+//
+// Graphics Programming Conference 2024
+// https://www.graphicsprogrammingconference.nl/
+//
+// Wide BVH
+//
+// A bounding volume hierarchy whose nodes have one child per lane of the ISPC
+// gang, so IntersectBvh in part_3.ispc slab tests every child box of a node
+// with one varying load. WideNode<Width> stores its children SoA: 8 arrays of
+// Width floats and ints, 32 * Width bytes, which is exactly a varying WideNode
+// and a whole number of cache lines for every gang width from 2 up.
+//
+// Build splits ranges of triangles with a binned surface area heuristic and
+// collapses the binary splits straight into wide nodes: a node keeps opening
+// its child with the largest surface area until it has Width children or none
+// of them is worth splitting. Leaves hold at most Width triangles, tested as
+// one batch. Subtrees and the binning of large ranges run as tasks on the task
+// system (common/tasksys.h), the partitions run in the task that owns the range.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "allocator.h"
+#include "geometry.h"
+#include "tasksys.h"
+
+namespace Bvh
+{
+	using Types::Triangle;
+	using Types::Vector3;
+
+	static constexpr int SAH_BINS = 16;
+
+	// entries in the traversal stacks, BVH_STACK_SIZE in part_3.ispc
+	static constexpr size_t STACK_SIZE = 1024;
+
+	// ranges are binned in tasks of this many triangles, subtrees at least this large are built in a task of their own
+	static constexpr uint32_t PARALLEL_BINNING = 1 << 16;
+	static constexpr uint32_t PARALLEL_SUBTREE = 1 << 12;
+
+	inline float Component(const Vector3& v, const int axis)
+	{
+		return axis == 0 ? v.x : axis == 1 ? v.y : v.z;
+	}
+
+	struct Aabb
+	{
+		Vector3 lower = { FLT_MAX, FLT_MAX, FLT_MAX };
+		Vector3 upper = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+		void Grow(const Vector3& v)
+		{
+			lower = { std::min(lower.x, v.x), std::min(lower.y, v.y), std::min(lower.z, v.z) };
+			upper = { std::max(upper.x, v.x), std::max(upper.y, v.y), std::max(upper.z, v.z) };
+		}
+
+		// empty boxes leave it as it is
+		void Grow(const Aabb& box)
+		{
+			lower = { std::min(lower.x, box.lower.x), std::min(lower.y, box.lower.y), std::min(lower.z, box.lower.z) };
+			upper = { std::max(upper.x, box.upper.x), std::max(upper.y, box.upper.y), std::max(upper.z, box.upper.z) };
+		}
+
+		// surface area, 0 when empty
+		float Area() const
+		{
+			const float dx = upper.x - lower.x;
+			const float dy = upper.y - lower.y;
+			const float dz = upper.z - lower.z;
+
+			return dx < 0 || dy < 0 || dz < 0 ? 0.0f : 2.0f * (dx * dy + dy * dz + dz * dx);
+		}
+	};
+
+	// Width children, lane by lane. Empty lanes have inverted boxes, which the sign
+	// based slab test never hits, and a child of -1.
+	template <size_t Width>
+	struct alignas(Memory::CACHE_LINE_SIZE) WideNode
+	{
+		float minX[Width], minY[Width], minZ[Width];
+		float maxX[Width], maxY[Width], maxZ[Width];
+		int32_t child[Width]; // inner: node index, leaf: first triangle
+		int32_t count[Width]; // leaf: triangle count, 0 for inner and empty lanes
+	};
+
+	template <size_t Width>
+	struct Tree
+	{
+		Memory::Vector<WideNode<Width>> nodes; // node 0 is the root
+		std::vector<Triangle> triangles;       // in leaf order
+		std::vector<int32_t> indices;          // leaf order to mesh order
+
+		// memory footprint of everything the traversal reads
+		size_t Bytes() const
+		{
+			return nodes.size() * sizeof(WideNode<Width>) + triangles.size() * sizeof(Triangle) + indices.size() * sizeof(int32_t);
+		}
+	};
+
+	// Wide levels built with SAH splits. Below them ranges split at the median of
+	// their largest child, which shrinks every child by at least Width / 2 per level,
+	// so the stack never needs more than STACK_SIZE entries: a node pushes at most
+	// Width - 1 more than it pops, for 2^32 triangles.
+	template <size_t Width>
+	constexpr int SahDepth()
+	{
+		int medianLevels = 1;
+		for (uint64_t count = 1; count < (uint64_t(1) << 32); count *= std::max<uint64_t>(2, Width / 2))
+		{
+			++medianLevels;
+		}
+
+		return std::max(1, static_cast<int>((STACK_SIZE - 1) / (Width - 1)) - medianLevels);
+	}
+
+	template <size_t Width>
+	class Builder
+	{
+		static_assert(Width >= 2, "a wide node needs at least two children");
+
+	public:
+		typedef Memory::Vector<WideNode<Width>> Nodes;
+
+		Builder(const std::vector<Triangle>& triangles, const bool parallel)
+			: m_triangles(triangles)
+			, m_primitives(triangles.size())
+			, m_parallel(parallel)
+		{
+		}
+
+		Tree<Width> Build()
+		{
+			const uint32_t count = static_cast<uint32_t>(m_triangles.size());
+
+			ParallelFor(count, [this](const uint32_t begin, const uint32_t end, int)
+			{
+				for (uint32_t i = begin; i < end; ++i)
+				{
+					const Triangle& tri = m_triangles[i];
+
+					Aabb bounds;
+					bounds.Grow(tri.v0);
+					bounds.Grow(tri.v1);
+					bounds.Grow(tri.v2);
+
+					Primitive& primitive = m_primitives[i];
+					primitive.bounds = bounds;
+					primitive.centroid = { 0.5f * (bounds.lower.x + bounds.upper.x), 0.5f * (bounds.lower.y + bounds.upper.y), 0.5f * (bounds.lower.z + bounds.upper.z) };
+					primitive.index = i;
+				}
+			});
+
+			Tree<Width> tree;
+			tree.nodes.resize(1);
+			BuildNode(MakeRange(0, count), 0, tree.nodes, 0);
+
+			tree.triangles.resize(count);
+			tree.indices.resize(count);
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				tree.triangles[i] = m_triangles[m_primitives[i].index];
+				tree.indices[i] = static_cast<int32_t>(m_primitives[i].index);
+			}
+
+			return tree;
+		}
+
+	private:
+		struct Split
+		{
+			bool evaluated = false;
+			int axis = -1;         // -1 if no bin boundary separates the range
+			int bin = 0;           // triangles with centroids in lower bins go left
+			float cost = FLT_MAX;  // in leaf batches, see FindSplit
+		};
+
+		// what the build knows about a triangle, reordered in place as ranges split so every pass over a range is sequential
+		struct Primitive
+		{
+			Aabb bounds;
+			Vector3 centroid;
+			uint32_t index;
+		};
+
+		struct Range
+		{
+			uint32_t begin = 0, end = 0;
+			Aabb bounds;    // of the triangles
+			Aabb centroids; // of their centroids, which is what gets binned
+			Split split;
+
+			uint32_t Count() const { return end - begin; }
+		};
+
+		struct Bins
+		{
+			Aabb bounds[3][SAH_BINS];
+			uint32_t counts[3][SAH_BINS] = {};
+		};
+
+		Range MakeRange(const uint32_t begin, const uint32_t end) const
+		{
+			Range range;
+			range.begin = begin;
+			range.end = end;
+
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				range.bounds.Grow(m_primitives[i].bounds);
+				range.centroids.Grow(m_primitives[i].centroid);
+			}
+
+			return range;
+		}
+
+		// maps centroids to bins along each axis of a range, all in bin 0 for an axis the centroids are flat on.
+		// Small ranges get a bin per triangle at most, there's nothing to gain from more.
+		struct Binning
+		{
+			float lower[3];
+			float scale[3];
+			int count;
+
+			explicit Binning(const Range& range)
+				: count(static_cast<int>(std::min<uint32_t>(SAH_BINS, range.Count())))
+			{
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					const float extent = Component(range.centroids.upper, axis) - Component(range.centroids.lower, axis);
+
+					lower[axis] = Component(range.centroids.lower, axis);
+					scale[axis] = extent > 0 ? count / extent : 0.0f;
+					scale[axis] = std::isfinite(scale[axis]) ? scale[axis] : 0.0f;
+				}
+			}
+
+			int Index(const int axis, const float centroid) const
+			{
+				return std::min(count - 1, static_cast<int>((centroid - lower[axis]) * scale[axis]));
+			}
+		};
+
+		void Bin(const Binning& binning, const uint32_t begin, const uint32_t end, Bins& bins) const
+		{
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				const Vector3& centroid = m_primitives[i].centroid;
+				const Aabb& bounds = m_primitives[i].bounds;
+
+				const int x = binning.Index(0, centroid.x);
+				const int y = binning.Index(1, centroid.y);
+				const int z = binning.Index(2, centroid.z);
+
+				bins.bounds[0][x].Grow(bounds);
+				bins.bounds[1][y].Grow(bounds);
+				bins.bounds[2][z].Grow(bounds);
+				++bins.counts[0][x];
+				++bins.counts[1][y];
+				++bins.counts[2][z];
+			}
+		}
+
+		// The cheapest bin boundary on any axis. Both sides of a split become children of
+		// the same wide node, so it adds no node visit: it costs the leaf batches of each
+		// side weighted by the chance a ray through the range hits that side, its area over
+		// the range's area. Kept as a leaf, a range of up to Width triangles costs 1.
+		void FindSplit(Range& range)
+		{
+			const Binning binning(range);
+			Bins bins;
+			std::vector<Bins> partial(TaskCount(range.Count()) - 1);
+
+			// the first task bins into bins and the others into partial
+			ParallelFor(range.Count(), [&](const uint32_t begin, const uint32_t end, const int task)
+			{
+				Bin(binning, range.begin + begin, range.begin + end, task == 0 ? bins : partial[task - 1]);
+			});
+
+			for (const Bins& other : partial)
+			{
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					for (int bin = 0; bin < binning.count; ++bin)
+					{
+						bins.bounds[axis][bin].Grow(other.bounds[axis][bin]);
+						bins.counts[axis][bin] += other.counts[axis][bin];
+					}
+				}
+			}
+
+			const float scale = 1.0f / std::max(range.bounds.Area(), FLT_MIN);
+
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				// areas and counts of every right side, swept from the top bin down
+				float rightArea[SAH_BINS];
+				uint32_t rightCount[SAH_BINS];
+
+				Aabb right;
+				uint32_t count = 0;
+				for (int bin = binning.count - 1; bin > 0; --bin)
+				{
+					right.Grow(bins.bounds[axis][bin]);
+					count += bins.counts[axis][bin];
+					rightArea[bin] = right.Area();
+					rightCount[bin] = count;
+				}
+
+				Aabb left;
+				count = 0;
+				for (int bin = 1; bin < binning.count; ++bin)
+				{
+					left.Grow(bins.bounds[axis][bin - 1]);
+					count += bins.counts[axis][bin - 1];
+
+					if (count == 0 || rightCount[bin] == 0)
+					{
+						continue;
+					}
+
+					const float cost = (left.Area() * Batches(count) + rightArea[bin] * Batches(rightCount[bin])) * scale;
+					if (cost < range.split.cost)
+					{
+						range.split.axis = axis;
+						range.split.bin = bin;
+						range.split.cost = cost;
+					}
+				}
+			}
+
+			range.split.evaluated = true;
+		}
+
+		// leaf batches of up to Width triangles it takes to test count triangles
+		static float Batches(const uint32_t count)
+		{
+			return static_cast<float>((count + Width - 1) / Width);
+		}
+
+		// more than Width triangles always split, fewer only if two tighter batches beat one
+		bool Openable(Range& range, const int depth)
+		{
+			if (range.Count() > Width)
+			{
+				return true;
+			}
+
+			if (range.Count() <= 1 || depth >= m_sahDepth)
+			{
+				return false;
+			}
+
+			if (!range.split.evaluated)
+			{
+				FindSplit(range);
+			}
+
+			return range.split.axis >= 0 && range.split.cost < 1.0f;
+		}
+
+		void SplitRange(Range& range, const int depth, Range& left, Range& right)
+		{
+			const bool sah = depth < m_sahDepth;
+			if (sah && !range.split.evaluated)
+			{
+				FindSplit(range);
+			}
+
+			Primitive* const primitives = m_primitives.data();
+
+			left = Range();
+			right = Range();
+			left.begin = range.begin;
+			right.end = range.end;
+
+			if (sah && range.split.axis >= 0)
+			{
+				// partitions in place, growing the bounds of both sides on the way
+				const Binning binning(range);
+				const int axis = range.split.axis;
+
+				uint32_t first = range.begin;
+				uint32_t last = range.end;
+				while (first < last)
+				{
+					const Primitive& primitive = primitives[first];
+					if (binning.Index(axis, Component(primitive.centroid, axis)) < range.split.bin)
+					{
+						left.bounds.Grow(primitive.bounds);
+						left.centroids.Grow(primitive.centroid);
+						++first;
+					}
+					else
+					{
+						right.bounds.Grow(primitive.bounds);
+						right.centroids.Grow(primitive.centroid);
+						std::swap(primitives[first], primitives[--last]);
+					}
+				}
+
+				left.end = first;
+				right.begin = first;
+			}
+			else
+			{
+				// median of the widest centroid axis, for ranges no bin boundary separates and below the SAH levels
+				const Vector3 extent = { range.centroids.upper.x - range.centroids.lower.x, range.centroids.upper.y - range.centroids.lower.y, range.centroids.upper.z - range.centroids.lower.z };
+				const int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : extent.y >= extent.z ? 1 : 2;
+
+				const uint32_t middle = range.begin + range.Count() / 2;
+				std::nth_element(primitives + range.begin, primitives + middle, primitives + range.end, [&](const Primitive& a, const Primitive& b)
+				{
+					return Component(a.centroid, axis) < Component(b.centroid, axis);
+				});
+
+				left = MakeRange(range.begin, middle);
+				right = MakeRange(middle, range.end);
+			}
+		}
+
+		// fills nodes[nodeIndex] and appends its subtree to nodes
+		void BuildNode(Range range, const int depth, Nodes& nodes, const uint32_t nodeIndex)
+		{
+			Range children[Width];
+			children[0] = range;
+			size_t childCount = 1;
+
+			// open the largest child until the node is full, by count below the SAH levels so the tree stays shallow
+			const bool sah = depth < m_sahDepth;
+			while (childCount < Width)
+			{
+				size_t open = Width;
+				float largest = -1.0f;
+
+				for (size_t c = 0; c < childCount; ++c)
+				{
+					const float size = sah ? children[c].bounds.Area() : static_cast<float>(children[c].Count());
+					if (size > largest && Openable(children[c], depth))
+					{
+						open = c;
+						largest = size;
+					}
+				}
+
+				if (open == Width)
+				{
+					break;
+				}
+
+				Range left, right;
+				SplitRange(children[open], depth, left, right);
+				children[open] = left;
+				children[childCount++] = right;
+			}
+
+			WideNode<Width> node;
+			for (size_t lane = 0; lane < Width; ++lane)
+			{
+				// only the root of an empty mesh has an empty child
+				const bool used = lane < childCount && children[lane].Count() > 0;
+
+				const Aabb empty;
+				const Aabb& box = used ? children[lane].bounds : empty;
+
+				node.minX[lane] = box.lower.x;
+				node.minY[lane] = box.lower.y;
+				node.minZ[lane] = box.lower.z;
+				node.maxX[lane] = box.upper.x;
+				node.maxY[lane] = box.upper.y;
+				node.maxZ[lane] = box.upper.z;
+				node.child[lane] = -1;
+				node.count[lane] = 0;
+
+				if (used && children[lane].Count() <= Width)
+				{
+					node.child[lane] = static_cast<int32_t>(children[lane].begin);
+					node.count[lane] = static_cast<int32_t>(children[lane].Count());
+				}
+				else if (used)
+				{
+					node.child[lane] = static_cast<int32_t>(nodes.size());
+					nodes.emplace_back();
+				}
+			}
+			nodes[nodeIndex] = node;
+
+			// large subtrees are built in tasks, each into nodes of its own that are appended after
+			struct Subtree
+			{
+				Nodes nodes;
+				uint32_t root;
+				Range range;
+			};
+			std::vector<Subtree> subtrees;
+			std::vector<size_t> inlineLanes;
+
+			for (size_t lane = 0; lane < childCount; ++lane)
+			{
+				if (node.count[lane] != 0 || node.child[lane] < 0)
+				{
+					continue;
+				}
+
+				if (m_parallel && children[lane].Count() >= PARALLEL_SUBTREE)
+				{
+					Subtree& subtree = subtrees.emplace_back();
+					subtree.root = static_cast<uint32_t>(node.child[lane]);
+					subtree.range = children[lane];
+				}
+				else
+				{
+					inlineLanes.push_back(lane);
+				}
+			}
+
+			// task 0 builds the small subtrees straight into nodes, every other task one large subtree
+			auto build = [&](const int task, int)
+			{
+				if (task == 0)
+				{
+					for (const size_t lane : inlineLanes)
+					{
+						BuildNode(children[lane], depth + 1, nodes, static_cast<uint32_t>(node.child[lane]));
+					}
+				}
+				else
+				{
+					Subtree& subtree = subtrees[task - 1];
+					subtree.nodes.resize(1);
+					BuildNode(subtree.range, depth + 1, subtree.nodes, 0);
+				}
+			};
+
+			if (subtrees.empty())
+			{
+				build(0, 1);
+			}
+			else
+			{
+				TaskSys::Launch(static_cast<int>(subtrees.size()) + 1, build);
+			}
+
+			for (Subtree& subtree : subtrees)
+			{
+				// its root takes the place reserved for it, the rest move up by offset
+				const uint32_t offset = static_cast<uint32_t>(nodes.size()) - 1;
+				for (size_t i = 0; i < subtree.nodes.size(); ++i)
+				{
+					WideNode<Width>& moved = subtree.nodes[i];
+					for (size_t lane = 0; lane < Width; ++lane)
+					{
+						if (moved.count[lane] == 0 && moved.child[lane] >= 0)
+						{
+							moved.child[lane] += offset;
+						}
+					}
+
+					if (i == 0)
+					{
+						nodes[subtree.root] = moved;
+					}
+					else
+					{
+						nodes.push_back(moved);
+					}
+				}
+			}
+		}
+
+		// tasks ParallelFor splits count triangles into
+		int TaskCount(const uint32_t count) const
+		{
+			return m_parallel ? static_cast<int>(std::max<uint32_t>(1, count / PARALLEL_BINNING)) : 1;
+		}
+
+		// calls proc(begin, end, task) on TaskCount(count) equal chunks of [0, count), in tasks if there's more than one
+		template <typename Proc>
+		void ParallelFor(const uint32_t count, Proc&& proc)
+		{
+			const int tasks = TaskCount(count);
+			if (tasks == 1)
+			{
+				proc(0, count, 0);
+				return;
+			}
+
+			auto chunk = [&](const int task, const int taskCount)
+			{
+				const uint64_t begin = static_cast<uint64_t>(count) * task / taskCount;
+				const uint64_t end = static_cast<uint64_t>(count) * (task + 1) / taskCount;
+				proc(static_cast<uint32_t>(begin), static_cast<uint32_t>(end), task);
+			};
+
+			TaskSys::Launch(tasks, chunk);
+		}
+
+		const std::vector<Triangle>& m_triangles;
+		std::vector<Primitive> m_primitives;
+		const bool m_parallel;
+
+		static constexpr int m_sahDepth = SahDepth<Width>();
+	};
+
+	// builds on the calling thread, or in tasks on the task system's threads if parallel
+	template <size_t Width>
+	Tree<Width> Build(const std::vector<Triangle>& triangles, const bool parallel = true)
+	{
+		return Builder<Width>(triangles, parallel).Build();
+	}
+}
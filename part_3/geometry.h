@@ -0,0 +1,172 @@
+// Copyright(c) 2024, Pete Brubaker <pete.brubaker@intel.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// ISPC: Making CPU SIMD fun while tracing rays!
+//
+// Graphics Programming Conference 2024
+// https://www.graphicsprogrammingconference.nl/
+//
+// Geometry
+//
+// The C++ side of the part_3.ispc types, plus triangle meshes loaded from OBJ
+// files with tiny_obj_loader. The translation unit that defines
+// TINYOBJLOADER_IMPLEMENTATION before including this compiles the loader.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "tiny_obj_loader/tiny_obj_loader.h"
+
+using std::vector;
+
+namespace Types
+{
+	struct Vector3
+	{
+		float x, y, z;
+	};
+
+	struct Triangle
+	{
+		Vector3 v0, v1, v2;
+	};
+
+	struct Ray
+	{
+		Vector3 origin;
+		Vector3 direction;
+	};
+}
+
+namespace Mesh
+{
+	using Types::Triangle;
+	using Types::Vector3;
+
+	// the faces of every shape, triangulated by the reader
+	inline bool FromObj(const tinyobj::ObjReader& reader, const char* name, vector<Triangle>& triangles)
+	{
+		if (!reader.Valid())
+		{
+			fprintf(stderr, "%s: %s\n", name, reader.Error().c_str());
+			return false;
+		}
+
+		const vector<tinyobj::real_t>& vertices = reader.GetAttrib().vertices;
+		auto vertex = [&](const tinyobj::index_t& index)
+		{
+			return Vector3{ vertices[3 * index.vertex_index + 0], vertices[3 * index.vertex_index + 1], vertices[3 * index.vertex_index + 2] };
+		};
+
+		triangles.clear();
+
+		for (const tinyobj::shape_t& shape : reader.GetShapes())
+		{
+			const vector<tinyobj::index_t>& indices = shape.mesh.indices;
+
+			for (size_t i = 0; i + 2 < indices.size(); i += 3)
+			{
+				triangles.push_back({ vertex(indices[i]), vertex(indices[i + 1]), vertex(indices[i + 2]) });
+			}
+		}
+
+		return !triangles.empty();
+	}
+
+	inline bool LoadObj(const char* path, vector<Triangle>& triangles)
+	{
+		tinyobj::ObjReader reader;
+		reader.ParseFromFile(path);
+
+		return FromObj(reader, path, triangles);
+	}
+
+	inline bool ParseObj(const std::string& text, vector<Triangle>& triangles)
+	{
+		tinyobj::ObjReader reader;
+		reader.ParseFromString(text, "");
+
+		return FromObj(reader, "obj text", triangles);
+	}
+
+	// OBJ text of a bumpy unit UV sphere with at least triangleCount triangles,
+	// rings rings and 2 * rings segments make 4 * rings * (rings - 1) triangles
+	inline std::string SphereObj(const size_t triangleCount)
+	{
+		size_t rings = 2;
+		while (4 * rings * (rings - 1) < triangleCount)
+		{
+			++rings;
+		}
+
+		const size_t segments = 2 * rings;
+		const float pi = 3.14159265358979f;
+
+		std::string obj;
+		char line[96];
+
+		auto point = [&](const float theta, const float phi)
+		{
+			const float r = 1.0f + 0.05f * std::sin(7.0f * theta) * std::sin(5.0f * phi);
+			snprintf(line, sizeof(line), "v %f %f %f\n", r * std::sin(theta) * std::cos(phi), r * std::cos(theta), r * std::sin(theta) * std::sin(phi));
+			obj += line;
+		};
+
+		// vertex 1 is the north pole, then rings - 1 rings of segments vertices, then the south pole
+		point(0.0f, 0.0f);
+		for (size_t ring = 1; ring < rings; ++ring)
+		{
+			for (size_t segment = 0; segment < segments; ++segment)
+			{
+				point(pi * ring / rings, 2.0f * pi * segment / segments);
+			}
+		}
+		point(pi, 0.0f);
+
+		const size_t south = 2 + (rings - 1) * segments;
+		auto index = [&](const size_t ring, const size_t segment) { return 2 + (ring - 1) * segments + segment % segments; };
+		auto face = [&](const size_t a, const size_t b, const size_t c)
+		{
+			snprintf(line, sizeof(line), "f %zu %zu %zu\n", a, b, c);
+			obj += line;
+		};
+
+		for (size_t segment = 0; segment < segments; ++segment)
+		{
+			face(1, index(1, segment + 1), index(1, segment));
+
+			for (size_t ring = 1; ring + 1 < rings; ++ring)
+			{
+				face(index(ring, segment), index(ring, segment + 1), index(ring + 1, segment + 1));
+				face(index(ring, segment), index(ring + 1, segment + 1), index(ring + 1, segment));
+			}
+
+			face(index(rings - 1, segment), index(rings - 1, segment + 1), south);
+		}
+
+		return obj;
+	}
+}
@@ -0,0 +1,190 @@
+// Copyright(c) 2024, Pete Brubaker <pete.brubaker@intel.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include "bvh.h"
+#include "geometry.h"
+
+using std::vector;
+
+// Möller–Trumbore, true and t updated if the ray hits tri closer than t
+static inline bool IntersectTriangleCpp(const Types::Ray& ray, const Types::Triangle& tri, float& t)
+{
+	using Types::Vector3;
+
+	auto sub = [](const Vector3& a, const Vector3& b) { return Vector3{ a.x - b.x, a.y - b.y, a.z - b.z }; };
+	auto dot = [](const Vector3& a, const Vector3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; };
+	auto cross = [](const Vector3& a, const Vector3& b) { return Vector3{ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; };
+
+	const Vector3 e1 = sub(tri.v1, tri.v0);
+	const Vector3 e2 = sub(tri.v2, tri.v0);
+
+	const Vector3 p = cross(ray.direction, e2);
+	const float det = dot(e1, p);
+	if (std::fabs(det) <= 1e-8f)
+	{
+		return false;
+	}
+
+	const float invDet = 1.0f / det;
+
+	const Vector3 s = sub(ray.origin, tri.v0);
+	const float u = dot(s, p) * invDet;
+	if (u < 0.0f || u > 1.0f)
+	{
+		return false;
+	}
+
+	const Vector3 q = cross(s, e1);
+	const float v = dot(ray.direction, q) * invDet;
+	if (v < 0.0f || u + v > 1.0f)
+	{
+		return false;
+	}
+
+	const float distance = dot(e2, q) * invDet;
+	if (distance > 0.0f && distance < t)
+	{
+		t = distance;
+		return true;
+	}
+
+	return false;
+}
+
+// Möller–Trumbore against every triangle, the reference for the part_3.ispc kernels
+// t starts as each ray's maximum distance and triangle as -1, closer hits overwrite both and ties keep the lowest index
+static inline void IntersectCpp(const vector<Types::Ray>& rays, const vector<Types::Triangle>& triangles, vector<float>& t, vector<int32_t>& triangle)
+{
+	#pragma loop(no_vector)
+	for (size_t r = 0; r < rays.size(); ++r)
+	{
+		for (size_t i = 0; i < triangles.size(); ++i)
+		{
+			if (IntersectTriangleCpp(rays[r], triangles[i], t[r]))
+			{
+				triangle[r] = static_cast<int32_t>(i);
+			}
+		}
+	}
+}
+
+// slab test reciprocal, tiny components are nudged away from zero so no box test produces a NaN
+static inline float SlabInverseCpp(const float d)
+{
+	return 1.0f / (std::fabs(d) > 1e-12f ? d : (d >= 0.0f ? 1e-12f : -1e-12f));
+}
+
+// The closest hit through a wide BVH, one child box at a time: leaves are tested as they're found and
+// inner children pushed farthest first. The scalar baseline for IntersectBvh in part_3.ispc, same
+// semantics as IntersectCpp except that ties between triangles can go either way.
+template <size_t Width>
+static inline void IntersectBvhCpp(const Bvh::Tree<Width>& tree, const vector<Types::Ray>& rays, vector<float>& t, vector<int32_t>& triangle)
+{
+	using Types::Vector3;
+
+	#pragma loop(no_vector)
+	for (size_t r = 0; r < rays.size(); ++r)
+	{
+		const Types::Ray& ray = rays[r];
+		const Vector3 inv = { SlabInverseCpp(ray.direction.x), SlabInverseCpp(ray.direction.y), SlabInverseCpp(ray.direction.z) };
+
+		int32_t stack[Bvh::STACK_SIZE];
+		float stackNear[Bvh::STACK_SIZE];
+		size_t sp = 0;
+
+		stack[sp] = 0;
+		stackNear[sp++] = 0.0f;
+
+		float closest = t[r];
+		int32_t closestTriangle = -1;
+
+		while (sp > 0)
+		{
+			--sp;
+			if (stackNear[sp] > closest)
+			{
+				continue;
+			}
+
+			const Bvh::WideNode<Width>& node = tree.nodes[stack[sp]];
+
+			// inner children hit, sorted farthest first
+			int32_t inner[Width];
+			float innerNear[Width];
+			size_t innerCount = 0;
+
+			for (size_t lane = 0; lane < Width; ++lane)
+			{
+				const float nearX = ((inv.x >= 0.0f ? node.minX[lane] : node.maxX[lane]) - ray.origin.x) * inv.x;
+				const float nearY = ((inv.y >= 0.0f ? node.minY[lane] : node.maxY[lane]) - ray.origin.y) * inv.y;
+				const float nearZ = ((inv.z >= 0.0f ? node.minZ[lane] : node.maxZ[lane]) - ray.origin.z) * inv.z;
+				const float farX = ((inv.x >= 0.0f ? node.maxX[lane] : node.minX[lane]) - ray.origin.x) * inv.x;
+				const float farY = ((inv.y >= 0.0f ? node.maxY[lane] : node.minY[lane]) - ray.origin.y) * inv.y;
+				const float farZ = ((inv.z >= 0.0f ? node.maxZ[lane] : node.minZ[lane]) - ray.origin.z) * inv.z;
+
+				const float tNear = std::max(std::max(nearX, nearY), std::max(nearZ, 0.0f));
+				const float tFar = std::min(std::min(farX, farY), std::min(farZ, closest));
+				if (tNear > tFar)
+				{
+					continue;
+				}
+
+				if (node.count[lane] > 0)
+				{
+					for (int32_t i = node.child[lane]; i < node.child[lane] + node.count[lane]; ++i)
+					{
+						if (IntersectTriangleCpp(ray, tree.triangles[i], closest))
+						{
+							closestTriangle = i;
+						}
+					}
+				}
+				else
+				{
+					size_t i = innerCount++;
+					for (; i > 0 && innerNear[i - 1] < tNear; --i)
+					{
+						inner[i] = inner[i - 1];
+						innerNear[i] = innerNear[i - 1];
+					}
+					inner[i] = node.child[lane];
+					innerNear[i] = tNear;
+				}
+			}
+
+			for (size_t i = 0; i < innerCount; ++i)
+			{
+				stack[sp] = inner[i];
+				stackNear[sp++] = innerNear[i];
+			}
+		}
+
+		if (closestTriangle >= 0)
+		{
+			t[r] = closest;
+			triangle[r] = tree.indices[closestTriangle];
+		}
+	}
+}
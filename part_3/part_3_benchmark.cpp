@@ -0,0 +1,585 @@
+// Copyright(c) 2024, Pete Brubaker <pete.brubaker@intel.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// the one translation unit that compiles tiny_obj_loader
+#define TINYOBJLOADER_IMPLEMENTATION
+
+#include "benchmark.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <random>
+
+#include "aosoa.h"
+#include "bvh.h"
+#include "geometry.h"
+#include "part_3.h"
+#include "part_3_ispc.h"
+#include "tasksys.h"
+
+using std::vector;
+
+// per-target entry points, selected with --ispc-target
+ISPC_DECLARE_TARGETS(GetProgramCount);
+ISPC_DECLARE_TARGETS(IntersectPacketsAoS);
+ISPC_DECLARE_TARGETS(IntersectPacketsSoA);
+ISPC_DECLARE_TARGETS(IntersectPacketsAoSoA);
+ISPC_DECLARE_TARGETS(IntersectBatchesAoS);
+ISPC_DECLARE_TARGETS(IntersectBatchesSoA);
+ISPC_DECLARE_TARGETS(IntersectBatchesAoSoA);
+ISPC_DECLARE_TARGETS(IntersectBvh);
+ISPC_DECLARE_TARGETS(IntersectBvh_Tasks);
+
+namespace
+{
+	using Types::Ray;
+	using Types::Triangle;
+	using Types::Vector3;
+
+	// we're using static seeds so we get the same rays every time
+	static constexpr uint32_t RAND_SEED = 0xBAAABAAA;
+
+	// --obj=<path>
+	const char*& ObjPath()
+	{
+		static const char* path = nullptr;
+		return path;
+	}
+
+	// the mesh from --obj, or a generated sphere of at least minTriangles, parsed by tiny_obj_loader either way
+	const vector<Triangle>& SceneMesh(const size_t minTriangles)
+	{
+		static vector<Triangle> obj;
+		static std::map<size_t, vector<Triangle>> spheres;
+
+		if (ObjPath())
+		{
+			if (obj.empty() && !Mesh::LoadObj(ObjPath(), obj))
+			{
+				fprintf(stderr, "%s: no triangles, using a sphere\n", ObjPath());
+				ObjPath() = nullptr;
+			}
+			else
+			{
+				return obj;
+			}
+		}
+
+		vector<Triangle>& sphere = spheres[minTriangles];
+		if (sphere.empty())
+		{
+			Mesh::ParseObj(Mesh::SphereObj(minTriangles), sphere);
+		}
+
+		return sphere;
+	}
+
+	// count triangles of the scene mesh, repeated if it has fewer
+	vector<Triangle> SceneTriangles(const size_t count)
+	{
+		const vector<Triangle>& mesh = SceneMesh(count);
+
+		vector<Triangle> triangles(count);
+		for (size_t i = 0; i < triangles.size(); ++i)
+		{
+			triangles[i] = mesh[i % mesh.size()];
+		}
+
+		return triangles;
+	}
+
+	void Bounds(const vector<Triangle>& triangles, Vector3& lower, Vector3& upper)
+	{
+		lower = { FLT_MAX, FLT_MAX, FLT_MAX };
+		upper = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+		for (const Triangle& tri : triangles)
+		{
+			for (const Vector3& v : { tri.v0, tri.v1, tri.v2 })
+			{
+				lower = { std::min(lower.x, v.x), std::min(lower.y, v.y), std::min(lower.z, v.z) };
+				upper = { std::max(upper.x, v.x), std::max(upper.y, v.y), std::max(upper.z, v.z) };
+			}
+		}
+	}
+
+	// rays from a sphere around the mesh towards random points in its bounds, so most hit something
+	vector<Ray> GenerateRays(const vector<Triangle>& triangles, const size_t count)
+	{
+		Vector3 lower, upper;
+		Bounds(triangles, lower, upper);
+
+		const Vector3 center = { 0.5f * (lower.x + upper.x), 0.5f * (lower.y + upper.y), 0.5f * (lower.z + upper.z) };
+		const Vector3 extent = { upper.x - center.x, upper.y - center.y, upper.z - center.z };
+		const float radius = 3.0f * std::sqrt(extent.x * extent.x + extent.y * extent.y + extent.z * extent.z);
+
+		std::mt19937 generator(RAND_SEED);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+		vector<Ray> rays(count);
+		for (Ray& ray : rays)
+		{
+			Vector3 on;
+			float length;
+			do
+			{
+				on = { unit(generator), unit(generator), unit(generator) };
+				length = std::sqrt(on.x * on.x + on.y * on.y + on.z * on.z);
+			} while (length < 1e-3f || length > 1.0f);
+
+			ray.origin = { center.x + radius * on.x / length, center.y + radius * on.y / length, center.z + radius * on.z / length };
+
+			const Vector3 target = { center.x + 0.8f * extent.x * unit(generator), center.y + 0.8f * extent.y * unit(generator), center.z + 0.8f * extent.z * unit(generator) };
+			const Vector3 direction = { target.x - ray.origin.x, target.y - ray.origin.y, target.z - ray.origin.z };
+			const float scale = 1.0f / std::sqrt(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z);
+
+			ray.direction = { direction.x * scale, direction.y * scale, direction.z * scale };
+		}
+
+		return rays;
+	}
+
+	// SoA copies of AoS data, Get() is what the ISPC kernels take
+	struct Vector3Arrays
+	{
+		vector<float> x, y, z;
+
+		void Resize(const size_t count)
+		{
+			x.resize(count);
+			y.resize(count);
+			z.resize(count);
+		}
+
+		void Set(const size_t i, const Vector3& v)
+		{
+			x[i] = v.x;
+			y[i] = v.y;
+			z[i] = v.z;
+		}
+
+		ispc::Vector3SoA Get() { return { x.data(), y.data(), z.data() }; }
+	};
+
+	struct RayArrays
+	{
+		Vector3Arrays origin, direction;
+
+		explicit RayArrays(const vector<Ray>& rays)
+		{
+			origin.Resize(rays.size());
+			direction.Resize(rays.size());
+
+			for (size_t i = 0; i < rays.size(); ++i)
+			{
+				origin.Set(i, rays[i].origin);
+				direction.Set(i, rays[i].direction);
+			}
+		}
+
+		ispc::RaySoA Get() { return { origin.Get(), direction.Get() }; }
+	};
+
+	struct TriangleArrays
+	{
+		Vector3Arrays v0, v1, v2;
+
+		explicit TriangleArrays(const vector<Triangle>& triangles)
+		{
+			v0.Resize(triangles.size());
+			v1.Resize(triangles.size());
+			v2.Resize(triangles.size());
+
+			for (size_t i = 0; i < triangles.size(); ++i)
+			{
+				v0.Set(i, triangles[i].v0);
+				v1.Set(i, triangles[i].v1);
+				v2.Set(i, triangles[i].v2);
+			}
+		}
+
+		ispc::TriangleSoA Get() { return { v0.Get(), v1.Get(), v2.Get() }; }
+	};
+
+	// closest hits, every ray starts with no hit
+	struct Hits
+	{
+		vector<float> t;
+		vector<int32_t> triangle;
+
+		explicit Hits(const size_t count)
+			: t(count, FLT_MAX)
+			, triangle(count, -1)
+		{
+		}
+
+		ispc::HitSoA Get() { return { t.data(), triangle.data() }; }
+	};
+
+	// ISPC and the reference can round differently, so a hit matches if it has the same triangle or the same distance
+	bool VerifyHits(const char* name, const Hits& hits, const Hits& expected)
+	{
+		for (size_t i = 0; i < expected.t.size(); ++i)
+		{
+			const bool sameTriangle = hits.triangle[i] == expected.triangle[i];
+			const bool sameDistance = hits.triangle[i] >= 0 && expected.triangle[i] >= 0 &&
+				std::fabs(hits.t[i] - expected.t[i]) <= 1e-4f * std::max(1.0f, expected.t[i]);
+
+			if (!sameTriangle && !sameDistance)
+			{
+				fprintf(stderr, "%s: mismatch at ray %zu (triangle %d at %f != triangle %d at %f)\n", name, i,
+					hits.triangle[i], hits.t[i], expected.triangle[i], expected.t[i]);
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// AoSoA blocks and BVH nodes have to be as wide as the gang of the ISPC target being run,
+	// calls proc.template operator()<Width>() with that width
+	template <typename Proc>
+	void WithGangWidth(const char* name, Proc&& proc)
+	{
+		const int programCount = ISPC_KERNEL(GetProgramCount)();
+
+		switch (programCount)
+		{
+		case 4: proc.template operator()<4>(); break;
+		case 8: proc.template operator()<8>(); break;
+		case 16: proc.template operator()<16>(); break;
+		case 32: proc.template operator()<32>(); break;
+		case 64: proc.template operator()<64>(); break;
+		default: fprintf(stderr, "%s: no layout for a gang width of %d\n", name, programCount); break;
+		}
+	}
+}
+
+
+// Ray-triangle intersection, Dim is the number of ray-triangle tests: Dim / TRIANGLE_BATCH rays against a batch of
+// TRIANGLE_BATCH triangles of the scene mesh, every ray against every triangle. Mops/s is millions of tests per second.
+// The tests don't stream memory, so there is no GB/s.
+#define INTERSECT_TESTS {1 << 16, 1 << 20, 1 << 24}
+
+namespace
+{
+	static constexpr size_t TRIANGLE_BATCH = 1024;
+
+	typedef decltype(&ispc::IntersectPacketsAoS) IntersectAoSKernel;
+	typedef decltype(&ispc::IntersectPacketsSoA) IntersectSoAKernel;
+	typedef decltype(&ispc::IntersectPacketsAoSoA) IntersectAoSoAKernel;
+
+	// TRIANGLE_BATCH triangles of the scene mesh
+	vector<Triangle> TriangleBatch()
+	{
+		return SceneTriangles(TRIANGLE_BATCH);
+	}
+
+	// trace(rays, hits) traces every ray against the batch once. Hits carry over from one repetition to the next,
+	// which changes neither the work nor the result.
+	template <typename Trace>
+	void Intersect(picobench::state& s, const vector<Triangle>& batch, const vector<Ray>& rays, Trace&& trace)
+	{
+		Hits hits(rays.size());
+
+		const int repetitions = Bench::Repetitions(s);
+
+		Bench::StartTimer(s);
+
+		#pragma loop(no_vector)
+		for (int i = 0; i < repetitions; ++i)
+		{
+			trace(hits);
+			s.set_result((uintptr_t)&hits);
+		}
+
+		Bench::StopTimer(s); // Manual stop
+
+		Bench::SetOpsPerElement(s, 1.0);
+
+		Hits expected(rays.size());
+		IntersectCpp(rays, batch, expected.t, expected.triangle);
+		VerifyHits(Bench::CurrentBenchmark(), hits, expected);
+	}
+
+	void IntersectAoS(picobench::state& s, IntersectAoSKernel kernel)
+	{
+		vector<Triangle> batch = TriangleBatch();
+		const vector<Ray> rays = GenerateRays(batch, s.iterations() / TRIANGLE_BATCH);
+		RayArrays rayArrays(rays);
+
+		Intersect(s, batch, rays, [&](Hits& hits)
+		{
+			kernel(rayArrays.Get(), hits.Get(), rays.size(), (ispc::Triangle*) batch.data(), batch.size());
+		});
+	}
+
+	void IntersectSoA(picobench::state& s, IntersectSoAKernel kernel)
+	{
+		const vector<Triangle> batch = TriangleBatch();
+		const vector<Ray> rays = GenerateRays(batch, s.iterations() / TRIANGLE_BATCH);
+		RayArrays rayArrays(rays);
+		TriangleArrays triangles(batch);
+
+		Intersect(s, batch, rays, [&](Hits& hits)
+		{
+			kernel(rayArrays.Get(), hits.Get(), rays.size(), triangles.Get(), batch.size());
+		});
+	}
+
+	template <size_t Width>
+	void IntersectAoSoA(picobench::state& s, IntersectAoSoAKernel kernel)
+	{
+		const vector<Triangle> batch = TriangleBatch();
+		const vector<Ray> rays = GenerateRays(batch, s.iterations() / TRIANGLE_BATCH);
+		RayArrays rayArrays(rays);
+		Types::AoSoA<Triangle, Width> triangles;
+
+		triangles.Assign(batch.data(), batch.size());
+
+		Intersect(s, batch, rays, [&](Hits& hits)
+		{
+			kernel(rayArrays.Get(), hits.Get(), rays.size(), triangles.Data(), batch.size());
+		});
+	}
+}
+
+PICOBENCH_SUITE("Intersect");
+
+static void intersect_CPP(picobench::state& s)
+{
+	const vector<Triangle> batch = TriangleBatch();
+	const vector<Ray> rays = GenerateRays(batch, s.iterations() / TRIANGLE_BATCH);
+
+	Intersect(s, batch, rays, [&](Hits& hits)
+	{
+		IntersectCpp(rays, batch, hits.t, hits.triangle);
+	});
+}
+PICOBENCH_THROUGHPUT(intersect_CPP, 0).iterations(INTERSECT_TESTS);
+
+static void intersect_ispc_Packets_AoS(picobench::state& s)
+{
+	IntersectAoS(s, ISPC_KERNEL(IntersectPacketsAoS));
+}
+PICOBENCH_THROUGHPUT(intersect_ispc_Packets_AoS, 0).iterations(INTERSECT_TESTS);
+
+static void intersect_ispc_Packets_SoA(picobench::state& s)
+{
+	IntersectSoA(s, ISPC_KERNEL(IntersectPacketsSoA));
+}
+PICOBENCH_THROUGHPUT(intersect_ispc_Packets_SoA, 0).iterations(INTERSECT_TESTS);
+
+static void intersect_ispc_Packets_AoSoA(picobench::state& s)
+{
+	WithGangWidth("intersect_ispc_Packets_AoSoA", [&]<size_t Width>() { IntersectAoSoA<Width>(s, ISPC_KERNEL(IntersectPacketsAoSoA)); });
+}
+PICOBENCH_THROUGHPUT(intersect_ispc_Packets_AoSoA, 0).iterations(INTERSECT_TESTS);
+
+static void intersect_ispc_Batches_AoS(picobench::state& s)
+{
+	IntersectAoS(s, ISPC_KERNEL(IntersectBatchesAoS));
+}
+PICOBENCH_THROUGHPUT(intersect_ispc_Batches_AoS, 0).iterations(INTERSECT_TESTS);
+
+static void intersect_ispc_Batches_SoA(picobench::state& s)
+{
+	IntersectSoA(s, ISPC_KERNEL(IntersectBatchesSoA));
+}
+PICOBENCH_THROUGHPUT(intersect_ispc_Batches_SoA, 0).iterations(INTERSECT_TESTS);
+
+static void intersect_ispc_Batches_AoSoA(picobench::state& s)
+{
+	WithGangWidth("intersect_ispc_Batches_AoSoA", [&]<size_t Width>() { IntersectAoSoA<Width>(s, ISPC_KERNEL(IntersectBatchesAoSoA)); });
+}
+PICOBENCH_THROUGHPUT(intersect_ispc_Batches_AoSoA, 0).iterations(INTERSECT_TESTS);
+
+
+// BVH build, Dim is the number of triangles, taken from the scene mesh. Mops/s is millions of triangles per
+// second and the working set is the memory footprint of the BVH: its nodes, triangles and indices.
+#define BVH_BUILD_TRIANGLES {1 << 12, 1 << 16, 1 << 20}
+
+namespace
+{
+	static constexpr int64_t BVH_BUILD_TRIANGLES_PER_SAMPLE = 1 << 21;
+
+	template <size_t Width>
+	void BuildBvh(picobench::state& s, const bool parallel)
+	{
+		const vector<Triangle> triangles = SceneTriangles(s.iterations());
+		size_t bytes = 0;
+
+		const int repetitions = Bench::Repetitions(s, BVH_BUILD_TRIANGLES_PER_SAMPLE);
+
+		Bench::StartTimer(s);
+
+		#pragma loop(no_vector)
+		for (int i = 0; i < repetitions; ++i)
+		{
+			const Bvh::Tree<Width> tree = Bvh::Build<Width>(triangles, parallel);
+			bytes = tree.Bytes();
+			s.set_result(bytes);
+		}
+
+		Bench::StopTimer(s); // Manual stop
+
+		Bench::SetOpsPerElement(s, 1.0);
+		Bench::SetWorkingSet(s, static_cast<double>(bytes));
+	}
+}
+
+PICOBENCH_SUITE("BvhBuild");
+
+static void bvh_build_CPP(picobench::state& s)
+{
+	WithGangWidth("bvh_build_CPP", [&]<size_t Width>() { BuildBvh<Width>(s, false); });
+}
+PICOBENCH_THROUGHPUT(bvh_build_CPP, 0).iterations(BVH_BUILD_TRIANGLES);
+
+static void bvh_build_CPP_Threads(picobench::state& s)
+{
+	WithGangWidth("bvh_build_CPP_Threads", [&]<size_t Width>() { BuildBvh<Width>(s, true); });
+}
+PICOBENCH_THROUGHPUT(bvh_build_CPP_Threads, 0).iterations(BVH_BUILD_TRIANGLES);
+
+
+// BVH traversal, Dim is the number of rays traced through a BVH of the scene mesh, BVH_TRACE_TRIANGLES
+// triangles of a generated sphere or the whole --obj mesh. Mops/s is millions of rays per second and the
+// working set is the memory footprint of the BVH.
+#define BVH_TRACE_RAYS {1 << 10, 1 << 14, 1 << 18}
+
+namespace
+{
+	static constexpr size_t BVH_TRACE_TRIANGLES = 1 << 18;
+	static constexpr int64_t BVH_TRACE_RAYS_PER_SAMPLE = 1 << 18;
+
+	// checked against IntersectCpp, which tests every triangle of the mesh
+	static constexpr size_t BVH_VERIFY_RAYS = 64;
+
+	// built once per width, on every thread
+	template <size_t Width>
+	const Bvh::Tree<Width>& SceneBvh()
+	{
+		static const Bvh::Tree<Width> tree = Bvh::Build<Width>(SceneMesh(BVH_TRACE_TRIANGLES));
+		return tree;
+	}
+
+	vector<Ray> SceneRays(const size_t count)
+	{
+		return GenerateRays(SceneMesh(BVH_TRACE_TRIANGLES), count);
+	}
+
+	// trace(hits) traces every ray once. Hits are cleared before every repetition, as a closest hit
+	// left over from the last one would cull almost the whole tree.
+	template <typename Trace>
+	void TraceBvh(picobench::state& s, const size_t bvhBytes, const vector<Ray>& rays, Trace&& trace)
+	{
+		Hits hits(rays.size());
+
+		const int repetitions = Bench::Repetitions(s, BVH_TRACE_RAYS_PER_SAMPLE);
+
+		Bench::StartTimer(s);
+
+		#pragma loop(no_vector)
+		for (int i = 0; i < repetitions; ++i)
+		{
+			std::fill(hits.t.begin(), hits.t.end(), FLT_MAX);
+			std::fill(hits.triangle.begin(), hits.triangle.end(), -1);
+
+			trace(hits);
+			s.set_result((uintptr_t)&hits);
+		}
+
+		Bench::StopTimer(s); // Manual stop
+
+		Bench::SetOpsPerElement(s, 1.0);
+		Bench::SetWorkingSet(s, static_cast<double>(bvhBytes));
+
+		const vector<Ray> verifyRays(rays.begin(), rays.begin() + std::min(rays.size(), BVH_VERIFY_RAYS));
+		Hits expected(verifyRays.size());
+		IntersectCpp(verifyRays, SceneMesh(BVH_TRACE_TRIANGLES), expected.t, expected.triangle);
+		VerifyHits(Bench::CurrentBenchmark(), hits, expected);
+	}
+
+	template <size_t Width>
+	void TraceBvhIspc(picobench::state& s, decltype(&ispc::IntersectBvh) kernel)
+	{
+		const Bvh::Tree<Width>& tree = SceneBvh<Width>();
+		const vector<Ray> rays = SceneRays(s.iterations());
+		RayArrays rayArrays(rays);
+		TriangleArrays triangles(tree.triangles);
+
+		const ispc::WideBvh bvh = { (float*) tree.nodes.data(), triangles.Get(), (int32_t*) tree.indices.data() };
+
+		TraceBvh(s, tree.Bytes(), rays, [&](Hits& hits)
+		{
+			kernel(bvh, rayArrays.Get(), hits.Get(), rays.size());
+		});
+	}
+}
+
+PICOBENCH_SUITE("BvhTrace");
+
+static void bvh_trace_CPP(picobench::state& s)
+{
+	WithGangWidth("bvh_trace_CPP", [&]<size_t Width>()
+	{
+		const Bvh::Tree<Width>& tree = SceneBvh<Width>();
+		const vector<Ray> rays = SceneRays(s.iterations());
+
+		TraceBvh(s, tree.Bytes(), rays, [&](Hits& hits)
+		{
+			IntersectBvhCpp(tree, rays, hits.t, hits.triangle);
+		});
+	});
+}
+PICOBENCH_THROUGHPUT(bvh_trace_CPP, 0).iterations(BVH_TRACE_RAYS);
+
+static void bvh_trace_ispc(picobench::state& s)
+{
+	WithGangWidth("bvh_trace_ispc", [&]<size_t Width>() { TraceBvhIspc<Width>(s, ISPC_KERNEL(IntersectBvh)); });
+}
+PICOBENCH_THROUGHPUT(bvh_trace_ispc, 0).iterations(BVH_TRACE_RAYS);
+
+static void bvh_trace_ispc_Tasks(picobench::state& s)
+{
+	WithGangWidth("bvh_trace_ispc_Tasks", [&]<size_t Width>() { TraceBvhIspc<Width>(s, ISPC_KERNEL(IntersectBvh_Tasks)); });
+}
+PICOBENCH_THROUGHPUT(bvh_trace_ispc_Tasks, 0).iterations(BVH_TRACE_RAYS);
+
+
+int main(int argc, char* argv[])
+{
+	return Bench::Main(argc, argv, [](const int target)
+	{
+		const auto programCount = IspcTarget_GetProgramCount(target);
+		return programCount ? static_cast<int>(programCount()) : 0;
+	},
+	[](picobench::runner& r)
+	{
+		r.add_cmd_opt("-obj=", "<path>", "Traces a mesh from an OBJ file instead of a generated sphere", [](uintptr_t, const char* arg)
+		{
+			ObjPath() = arg;
+			return *arg != 0;
+		});
+	});
+}